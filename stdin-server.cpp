@@ -1,120 +1,364 @@
+#include "utils/headers/analysis-pipeline.h"
+#include "utils/headers/batch-decode.h"
 #include "utils/headers/byte-stream-to-json.h"
+#include "utils/headers/document-store.h"
 #include "utils/headers/JSON-decode.h"
 #include "utils/headers/JSON-encode.h"
-#include "utils/headers/parameter-extraction.h"
-#include "utils/headers/print-helpers.h"
+#include "utils/headers/lsp-types.h"
+#include "utils/headers/progress-reporter.h"
 #include "utils/headers/logger.h"
+#include "utils/headers/method-dispatch.h"
+#include "utils/headers/request-executor.h"
+#include "utils/headers/response-sequencer.h"
+#include "utils/headers/trace-log.h"
+#include "utils/headers/transport.h"
+#include <charconv>
 #include <iostream>
-#include <sstream>
+
+#ifdef _WIN32
 #include <fcntl.h>
 #include <io.h>
+#else
+#include <csignal>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // Open documents, and the analysis that follows their edits, both owned by main
+    DocumentStore *documents = nullptr;
+    AnalysisPipeline *analysis = nullptr;
+
+    // $/progress for long jobs, owned by main
+    ProgressReporter *progress = nullptr;
+
+    // Lifecycle handlers, see notes/Server-Lifecycle.md
+    bool handleInitialize(RequestContext &ctx)
+    {
+        if (ctx.state.initialized)
+        {
+            ctx.error_code = ErrorCode::InvalidRequest;
+            ctx.error_message = "initialize has already been called";
+            return false;
+        }
+
+        // Only a few capabilities are looked at, anything that doesn't decode just leaves them off
+        InitializeParams params;
+        if (ctx.msg.params_json.has_value() && decodeParams(*ctx.msg.params_json, params) &&
+            params.capabilities.has_value() && params.capabilities->window.has_value())
+            progress->set_client_support(params.capabilities->window->workDoneProgress.value_or(false));
+
+        ctx.state.initialized = true;
+        JsonWriter &result = ctx.result;
+        result.begin_object();
+        result.key("capabilities");
+        result.begin_object();
+        result.key("textDocumentSync");
+        result.begin_object();
+        result.key("openClose");
+        result.value(true);
+        result.key("change");
+        result.value(2); // TextDocumentSyncKind.Incremental
+        result.end_object();
+        result.end_object();
+        result.key("serverInfo");
+        result.begin_object();
+        result.key("name");
+        result.string("go-language-server");
+        result.end_object();
+        result.end_object();
+        return true;
+    }
+
+    bool handleInitialized(RequestContext &)
+    {
+        return true;
+    }
+
+    bool handleShutdown(RequestContext &ctx)
+    {
+        ctx.state.shutdown = true;
+        analysis->stop();
+        progress->stop();
+        ctx.result.null();
+        return true;
+    }
+
+    bool handleExit(RequestContext &ctx)
+    {
+        ctx.state.exit = true;
+        return true;
+    }
+
+    // Notifications have no response to report bad params in, so they are only logged
+    template <typename Params>
+    bool decodeNotificationParams(RequestContext &ctx, Params &params)
+    {
+        if (ctx.msg.params_json.has_value() && decodeParams(*ctx.msg.params_json, params))
+            return true;
+        LSP_LOG(LogSeverity::Warning, LogEventType::Request, "Could not decode params of ", ctx.msg.method);
+        return false;
+    }
+
+    // Document sync handlers, see notes/Document-Sync.md
+    // Edits go into the store straight away, analysis is left to the pipeline to schedule
+
+    bool handleDidOpen(RequestContext &ctx)
+    {
+        DidOpenTextDocumentParams params;
+        if (!decodeNotificationParams(ctx, params))
+            return false;
+
+        documents->open(params.textDocument);
+        analysis->changed(params.textDocument.uri);
+        return true;
+    }
+
+    bool handleDidChange(RequestContext &ctx)
+    {
+        DidChangeTextDocumentParams params;
+        if (!decodeNotificationParams(ctx, params))
+            return false;
+
+        if (!documents->change(params.textDocument, params.contentChanges))
+        {
+            LSP_LOG(LogSeverity::Warning, LogEventType::Request, "didChange for a document that isn't open: ",
+                    params.textDocument.uri);
+            return false;
+        }
+        analysis->changed(params.textDocument.uri);
+        return true;
+    }
+
+    bool handleDidClose(RequestContext &ctx)
+    {
+        DidCloseTextDocumentParams params;
+        if (!decodeNotificationParams(ctx, params))
+            return false;
+
+        analysis->closed(params.textDocument.uri);
+        documents->close(params.textDocument.uri);
+        return true;
+    }
+
+    // Window handlers, see notes/Window-features.md
+    bool handleWorkDoneProgressCancel(RequestContext &ctx)
+    {
+        WorkDoneProgressCancelParams params;
+        if (!decodeNotificationParams(ctx, params))
+            return false;
+
+        progress->cancel(params.token);
+        return true;
+    }
+
+    // Responses to the server's own requests, only window/workDoneProgress/create so far
+    void handleClientResponse(const Message &msg)
+    {
+        if (!progress->handle_response(msg))
+            LSP_LOG(LogSeverity::Info, LogEventType::Request, "Response to an unknown or abandoned request: ", *msg.id);
+    }
+
+    // There is no Go analysis yet, so every document comes back clean
+    // (publishing that still clears anything the client was showing for it)
+    bool analyseDocument(const DocumentSnapshot &, const CancellationToken &, JsonWriter &)
+    {
+        return true;
+    }
+
+    // --name=<ms>, returns false if arg isn't that option
+    bool parseMilliseconds(std::string_view arg, std::string_view name, std::chrono::milliseconds &out)
+    {
+        if (arg.substr(0, name.size()) != name)
+            return false;
+
+        std::string_view digits = arg.substr(name.size());
+        long long value = 0;
+        std::from_chars_result r = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+        if (r.ec == std::errc() && r.ptr == digits.data() + digits.size() && value >= 0)
+            out = std::chrono::milliseconds(value);
+        else
+            std::cerr << "Ignoring " << arg << ", expected a number of milliseconds" << std::endl;
+        return true;
+    }
+}
 
-int main()
+// stdout carries the framed LSP packets, so anything human readable goes to stderr
+// --trace=<file> records a binary trace of every message (see tools/lsp-trace.cpp),
+// --trace-bodies also keeps the message bodies in it, so the session can be replayed
+// --debounce=<ms> and --debounce-max=<ms> set the didChange analysis windows (see analysis-pipeline.h)
+int main(int argc, char **argv)
 {
+#ifdef _WIN32
     _setmode(_fileno(stdin), _O_BINARY); // preserve \r\n on windows systems, where \r\n\r\n >> \n\n
+    _setmode(_fileno(stdout), _O_BINARY);
+    StreamTransport transport(std::cin, std::cout);
+#else
+    std::signal(SIGPIPE, SIG_IGN); // a closed client pipe should fail the write, not kill the server
+    FdTransport transport(STDIN_FILENO, STDOUT_FILENO);
+#endif
+
+    std::string tracePath;
+    bool traceBodies = false;
+    DebounceWindows debounce;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg = argv[i];
+        if (parseMilliseconds(arg, "--debounce=", debounce.quiet) ||
+            parseMilliseconds(arg, "--debounce-max=", debounce.max_delay))
+            continue;
+        if (arg.substr(0, 8) == "--trace=")
+            tracePath = arg.substr(8);
+        else if (arg == "--trace-bodies")
+            traceBodies = true;
+    }
+    if (!tracePath.empty() && !openTrace(tracePath, traceBodies))
+        std::cerr << "Trace file could not be created." << std::endl;
 
     // Start Logger
     std::string logDir = "logs";
     std::string logFile;
     if (!initialiseLogger(logDir, logFile))
     {
-        std::cout << "Logfile could not be created." << std::endl;
+        std::cerr << "Logfile could not be created." << std::endl;
     }
     else
     {
-        logEvent(logFile, "Server process started", LogEventType::Lifecycle, LogSeverity::Info);
+        LSP_LOG(LogSeverity::Info, LogEventType::Lifecycle, "Server process started");
     }
 
-    std::string json;
-    std::cout << "Message recieved" << std::endl;
-    logEvent(logFile, "Waiting for LSP messages on stdin", LogEventType::Lifecycle, LogSeverity::Info);
-
-    while (read_lsp_message(std::cin, json))
-    {
-        std::cout << "Headers Valid" << std::endl;
-        logEvent(logFile, "Received packet with valid LSP headers", LogEventType::Internal, LogSeverity::Info);
+    std::string_view json;
+    ServerState state;
 
-        Message msg;
-        if (!storeMessage(json, msg))
-        {
-            std::cout << "Message Invalid" << std::endl;
-            logEvent(logFile, "Message body failed JSON-RPC validation", LogEventType::Internal, LogSeverity::Warning);
-            continue;
-        }
+    // Read-only requests run on the executor, everything else runs here in the order it was read,
+    // and the sequencer decides when each response may go out
+    ResponseSequencer responses(transport);
+    ProgressReporter progressReporter(responses); // outlives the executor, jobs may still finish their tasks
+    progress = &progressReporter;
+    RequestExecutor executor;
 
-        std::cout << "Message Valid" << std::endl;
-        std::ostringstream messageSummary;
-        messageSummary << "Decoded message jsonrpc=" << msg.jsonrpc;
-        if (msg.id.has_value())
-            messageSummary << ", id=" << *msg.id;
-        else
-            messageSummary << ", id=<none>";
+    DocumentStore documentStore;
+    AnalysisPipeline analysisPipeline(documentStore, executor, responses, analyseDocument, debounce);
+    documents = &documentStore;
+    analysis = &analysisPipeline;
 
-        if (msg.method.has_value())
-            messageSummary << ", method=" << *msg.method;
-        else
-            messageSummary << ", method=<none>";
+    Dispatcher dispatcher;
+    registerHandler(dispatcher, LspMethod::Initialize, handleInitialize);
+    registerHandler(dispatcher, LspMethod::Initialized, handleInitialized);
+    registerHandler(dispatcher, LspMethod::Shutdown, handleShutdown);
+    registerHandler(dispatcher, LspMethod::Exit, handleExit);
+    registerHandler(dispatcher, LspMethod::DidOpen, handleDidOpen);
+    registerHandler(dispatcher, LspMethod::DidChange, handleDidChange);
+    registerHandler(dispatcher, LspMethod::DidClose, handleDidClose);
+    registerHandler(dispatcher, LspMethod::WorkDoneProgressCancel, handleWorkDoneProgressCancel);
+    registerResponseHandler(dispatcher, handleClientResponse);
 
-        LogEventType eventType = msg.method.has_value() ? LogEventType::Request : LogEventType::Response;
-        logEvent(logFile, messageSummary.str(), eventType, LogSeverity::Info);
+    JsonTape tape;
+    BatchDecoder batch;
+    LSP_LOG(LogSeverity::Info, LogEventType::Lifecycle, "Waiting for LSP messages on stdin");
 
-        std::cout << "jsonrpc Version: " << msg.jsonrpc << std::endl;
+    while (true)
+    {
+        // Outgoing packets are batched while more input is already waiting, and flushed before blocking
+        if (!lsp_message_buffered() && !responses.flush())
+            break;
 
-        if (msg.id.has_value())
-            std::cout << "ID: " << *msg.id << std::endl;
-        else
-            std::cout << "No ID" << std::endl;
+        if (!read_lsp_message(transport, json))
+            break;
+        traceEvent(TracePhase::Receive, LspMethod::Unknown, nullptr, json.size(), json);
 
-        if (msg.method.has_value())
-            std::cout << "Method: " << *msg.method << std::endl;
-        else
-            std::cout << "No Method" << std::endl;
+        LSP_LOG(LogSeverity::Info, LogEventType::Internal, "Received packet with valid LSP headers");
 
-        if (msg.params_json.has_value())
+        if (isBatch(json))
         {
-            std::cout << "Params: " << *msg.params_json << std::endl;
-            ParameterTree params;
-            if (extractParameters(*msg.params_json, params))
+            // Not even an array to reply with, so one error (with a null id) answers the whole thing
+            if (!decodeBatch(json, batch, executor))
             {
-                std::cout << "Layered Params: ";
-                print_helpers::printParameterTree(params, std::cout);
-                std::cout << std::endl;
-                logEvent(logFile, "Params parsed into ParameterTree", LogEventType::Request, LogSeverity::Info);
+                LSP_LOG(LogSeverity::Warning, LogEventType::Internal, "Batch body is not a non-empty JSON array");
+                if (batch.malformed)
+                    rejectMessage(responses, ErrorCode::ParseError, "Batch is not valid JSON");
+                else
+                    rejectMessage(responses, ErrorCode::InvalidRequest, "Batch is empty");
+                continue;
             }
-            else
+
+            LSP_LOG(LogSeverity::Info, LogEventType::Internal, "Batch of ", batch.messages.size(), " messages");
+
+            // Decoded in parallel, but dispatched in order, with the responses going back as one array
+            // Requests still running are let finish first, so no earlier ticket holds the batch's responses
+            // back past end_batch, and the batch itself runs inline. Background work carries on
+            responses.wait_released();
+            responses.begin_batch();
+            for (size_t i = 0; i < batch.messages.size() && !state.exit; ++i)
             {
-                std::cout << "Params could not be parsed into layered struct" << std::endl;
-                logEvent(logFile, "Params present but could not be parsed into ParameterTree", LogEventType::Request, LogSeverity::Warning);
-            }
-        }
-        else
-            std::cout << "No Parameters" << std::endl;
+                // Gets its own error in the reply array
+                if (!batch.valid[i])
+                {
+                    LSP_LOG(LogSeverity::Warning, LogEventType::Internal, "Batch element failed JSON-RPC validation");
+                    rejectMessage(responses, ErrorCode::InvalidRequest, "Batch element is not a valid JSON-RPC message");
+                    continue;
+                }
 
-        if (msg.result.has_value())
-            std::cout << "Result: " << *msg.result << std::endl;
-        else
-            std::cout << "No Results" << std::endl;
+                Message &element = batch.messages[i];
+                const RequestId *elementId = element.id.has_value() ? &*element.id : nullptr;
+                traceEvent(TracePhase::Decode, element.method_id, elementId, batch.elements[i].size());
+                dispatchMessage(dispatcher, state, std::move(element), responses, nullptr);
+            }
+            responses.end_batch();
 
-        if (msg.error.has_value())
-            std::cout << "Error(s): " << *msg.error << std::endl;
-        else
-            std::cout << "No Errors" << std::endl;
+            if (state.exit)
+            {
+                LSP_LOG(LogSeverity::Info, LogEventType::Lifecycle, "Exit notification received; server loop exiting");
+                break;
+            }
+            continue;
+        }
 
-        std::string serialisedMessage;
-        if (serialiseLspPacket(msg, serialisedMessage))
+        Message msg;
+        if (!storeMessage(json, msg, tape))
         {
-            std::cout << "\r\nEncoded Message: \r\n\r\n"
-                << serialisedMessage << std::endl;
-            logEvent(logFile, "Message serialised into LSP packet", LogEventType::Response, LogSeverity::Info);
+            LSP_LOG(LogSeverity::Warning, LogEventType::Internal, "Message body failed JSON-RPC validation");
+            continue;
         }
-        else
+
+        const RequestId *msgId = msg.id.has_value() ? &*msg.id : nullptr;
+        traceEvent(TracePhase::Decode, msg.method_id, msgId, json.size());
+
+        // Only formatted if Info events are being written
+        LogEventType eventType = msg.method.has_value() ? LogEventType::Request : LogEventType::Response;
+        LSP_LOG(LogSeverity::Info, eventType, "Decoded message id=", msg.id, ", method=", msg.method);
+
+        // Serial responses go out with the next flush, concurrent ones as soon as they are allowed to
+        dispatchMessage(dispatcher, state, std::move(msg), responses, &executor);
+
+        if (state.exit)
         {
-            std::cout << "Something went wrong encoding the message" << std::endl;
-            logEvent(logFile, "Failed to serialise message into LSP packet", LogEventType::Internal, LogSeverity::Error);
+            LSP_LOG(LogSeverity::Info, LogEventType::Lifecycle, "Exit notification received; server loop exiting");
+            break;
         }
     }
 
-    logEvent(logFile, "Input stream closed or unreadable; server loop exiting", LogEventType::Lifecycle, LogSeverity::Info);
+    // Requests still running get to answer before the process goes away, pending analyses don't
+    analysisPipeline.stop();
+    progressReporter.stop();
+    executor.wait_idle();
+    responses.flush();
+
+    // How long work sat queued in each lane, for tuning the lanes
+    for (size_t lane = 0; lane < kLaneCount; ++lane)
+    {
+        LaneStats stats = executor.lane_stats(static_cast<PriorityLane>(lane));
+        if (stats.started > 0)
+            LSP_LOG(LogSeverity::Info, LogEventType::Internal, "Lane ", laneName(static_cast<PriorityLane>(lane)),
+                    ": ", stats.started, " started, wait mean ", stats.mean_wait_us, " us, p99 <= ", stats.p99_wait_us,
+                    " us, max ", stats.max_wait_us, " us");
+    }
+    if (!state.exit)
+        LSP_LOG(LogSeverity::Info, LogEventType::Lifecycle, "Input stream closed or unreadable; server loop exiting");
+
+    closeTrace();
+    shutdownLogger();
 
-    return 0;
+    // Exiting without a shutdown request first is an error, as per the spec
+    return state.exit && !state.shutdown ? 1 : 0;
 }
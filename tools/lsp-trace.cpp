@@ -0,0 +1,212 @@
+#include "../utils/headers/lsp-methods.h"
+#include "../utils/headers/trace-log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+/*
+lsp-trace: reads the binary trace written by the server's --trace=<file> (see utils/headers/trace-log.h)
+
+    lsp-trace dump <file>              one line per record, with the time each message spent in the server
+    lsp-trace replay <file> [--timed]  writes the captured session (needs --trace-bodies) to stdout as LSP frames
+
+Replaying a session against a build:
+    lsp-trace replay session.trace --timed | ./go-language-server --trace=replay.trace
+--timed keeps the original gaps between messages, so debounce/batching behaves as it did live
+*/
+
+namespace
+{
+    struct TraceFile
+    {
+        std::vector<char> bytes;
+        TraceFileHeader header{};
+        size_t end = 0;
+    };
+
+    bool load_trace(const char *path, TraceFile &out)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open())
+        {
+            std::cerr << "cannot open " << path << std::endl;
+            return false;
+        }
+        out.bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+        if (out.bytes.size() < sizeof(TraceFileHeader))
+        {
+            std::cerr << path << " is too small to be a trace" << std::endl;
+            return false;
+        }
+        std::memcpy(&out.header, out.bytes.data(), sizeof(out.header));
+        if (std::memcmp(out.header.magic, kTraceMagic, sizeof(kTraceMagic)) != 0 || out.header.version != kTraceVersion)
+        {
+            std::cerr << path << " is not a version " << kTraceVersion << " trace" << std::endl;
+            return false;
+        }
+
+        // used_bytes is 0 if the server didn't get to close the trace, the zeroed tail ends it then
+        out.end = out.header.used_bytes != 0 && out.header.used_bytes <= out.bytes.size() ? out.header.used_bytes
+                                                                                            : out.bytes.size();
+        return true;
+    }
+
+    // Calls fn(record, raw body) for every record in order
+    template <typename Fn>
+    void for_each_record(const TraceFile &trace, Fn &&fn)
+    {
+        size_t offset = trace.header.header_size;
+        while (offset + sizeof(TraceRecord) <= trace.end)
+        {
+            TraceRecord record;
+            std::memcpy(&record, trace.bytes.data() + offset, sizeof(record));
+            if (record.timestamp_ns == 0)
+                break;
+
+            size_t raw_end = offset + sizeof(record) + record.raw_size;
+            if (raw_end > trace.end)
+                break;
+
+            fn(record, std::string_view(trace.bytes.data() + offset + sizeof(record), record.raw_size));
+            offset += sizeof(record) + ((record.raw_size + 7) & ~static_cast<size_t>(7));
+        }
+    }
+
+    std::string format_id(const TraceRecord &record)
+    {
+        switch (record.id_kind)
+        {
+        case TraceIdKind::Number:
+            return std::to_string(record.id_number);
+        case TraceIdKind::String:
+            return "\"" + std::string(record.id_text, record.id_size) + "\"";
+        default:
+            return "-";
+        }
+    }
+
+    int dump(const TraceFile &trace)
+    {
+        std::printf("trace v%u, %llu bytes, %llu dropped records\n", trace.header.version,
+                    static_cast<unsigned long long>(trace.end),
+                    static_cast<unsigned long long>(trace.header.dropped_records));
+
+        // Latency is measured from the Receive of the message being worked on
+        // Requests can finish on a worker after later messages have been read, so their Receive is found by id
+        uint64_t received = 0;
+        std::unordered_map<std::string, uint64_t> in_flight;
+        size_t count = 0;
+        for_each_record(trace, [&](const TraceRecord &record, std::string_view) {
+            if (record.phase == TracePhase::Receive)
+                received = record.timestamp_ns;
+
+            std::string id = format_id(record);
+            uint64_t started = received;
+            if (record.id_kind != TraceIdKind::None)
+            {
+                if (record.phase == TracePhase::Decode)
+                {
+                    in_flight[id] = received;
+                }
+                else if (record.phase == TracePhase::Dispatch)
+                {
+                    auto found = in_flight.find(id);
+                    if (found != in_flight.end())
+                    {
+                        started = found->second;
+                        in_flight.erase(found);
+                    }
+                }
+            }
+
+            std::string method(record.method == LspMethod::Unknown ? std::string_view("-") : methodName(record.method));
+            std::printf("%12.3f ms  %-8s  %-40s id=%-10s bytes=%u", record.timestamp_ns / 1e6,
+                        tracePhaseName(record.phase), method.c_str(), id.c_str(), record.body_size);
+            if (record.phase == TracePhase::Decode || record.phase == TracePhase::Dispatch)
+                std::printf("  +%.3f ms", (record.timestamp_ns - started) / 1e6);
+            std::printf("\n");
+            ++count;
+        });
+
+        std::printf("%zu records\n", count);
+        return 0;
+    }
+
+    int replay(const TraceFile &trace, bool timed)
+    {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        auto started = std::chrono::steady_clock::now();
+        size_t sent = 0;
+        size_t missing = 0;
+
+        for_each_record(trace, [&](const TraceRecord &record, std::string_view raw) {
+            if (record.phase != TracePhase::Receive)
+                return;
+            if (raw.size() != record.body_size)
+            {
+                ++missing;
+                return;
+            }
+
+            if (timed)
+            {
+                std::fflush(stdout);
+                std::this_thread::sleep_until(started + std::chrono::nanoseconds(record.timestamp_ns));
+            }
+
+            std::printf("Content-Length: %zu\r\n\r\n", raw.size());
+            std::fwrite(raw.data(), 1, raw.size(), stdout);
+            ++sent;
+        });
+        std::fflush(stdout);
+
+        std::cerr << "replayed " << sent << " messages";
+        if (missing > 0)
+            std::cerr << ", " << missing << " had no captured body (record with --trace-bodies)";
+        std::cerr << std::endl;
+        return missing > 0 && sent == 0 ? 1 : 0;
+    }
+
+    int usage()
+    {
+        std::cerr << "usage: lsp-trace dump <file>\n"
+                     "       lsp-trace replay <file> [--timed]"
+                  << std::endl;
+        return 2;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+        return usage();
+
+    std::string_view command = argv[1];
+    TraceFile trace;
+    if (command != "dump" && command != "replay")
+        return usage();
+    if (!load_trace(argv[2], trace))
+        return 1;
+
+    if (command == "dump")
+        return dump(trace);
+
+    bool timed = argc > 3 && std::string_view(argv[3]) == "--timed";
+    return replay(trace, timed);
+}
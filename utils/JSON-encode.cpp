@@ -1,6 +1,8 @@
 #include "headers/JSON-encode.h"
+#include "headers/JSON-scan.h"
 
-#include <cctype>
+#include <charconv>
+#include <cstdio>
 
 /*
 JSON serialisation (encoding a message)
@@ -10,10 +12,9 @@ I dont need to differentiate what type of outgoing message, just any message wil
 
 struct outgoingMessage
 {
-    float jsonrpc
-    std::optional<int>
+    std::optional<RequestId> id
     std::optional<std::string> method
-    std::optional<std::string> params_json
+    std::optional<std::string_view> params_json
     std::optional<std::string> result
     std::optional<std::string> error
 };
@@ -21,275 +22,18 @@ struct outgoingMessage
 
 namespace
 {
-    // Moves cursor past whitespace / special characters
-    void skip_ws(const std::string& s, size_t& i)
-    {
-        while (i < s.size())
-        {
-            char c = s[i];
-            if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
-                break;
-            ++i;
-        }
-    }
-
-    // Reads JSON string value while validating escapes and control characters
-    bool parse_string(const std::string& s, size_t& i)
-    {
-        if (i >= s.size() || s[i] != '"')
-            return false;
-        ++i;
-
-        while (i < s.size())
-        {
-            unsigned char c = static_cast<unsigned char>(s[i++]);
-
-            if (c == '"')
-                return true;
-
-            // Reject unescaped control characters
-            if (c < 0x20)
-                return false;
-
-            if (c != '\\')
-                continue;
-
-            if (i >= s.size())
-                return false;
-
-            char esc = s[i++];
-            switch (esc)
-            {
-            case '"':
-            case '\\':
-            case '/':
-            case 'b':
-            case 'f':
-            case 'n':
-            case 'r':
-            case 't':
-                break;
-            case 'u':
-            {
-                if (i + 4 > s.size())
-                    return false;
-                for (int j = 0; j < 4; ++j)
-                {
-                    unsigned char h = static_cast<unsigned char>(s[i + j]);
-                    if (!std::isxdigit(h))
-                        return false;
-                }
-                i += 4;
-                break;
-            }
-            default:
-                return false;
-            }
-        }
-
-        // If the closing '"' is missing, malformed JSON string
-        return false;
-    }
-
-    // Verifier tool to check value of keyword
-    // Used for "true", "false" and "null"
-    bool parse_literal(const std::string& s, size_t& i, const char* literal)
-    {
-        size_t j = 0;
-        while (literal[j] != '\0')
-        {
-            if (i + j >= s.size() || s[i + j] != literal[j])
-                return false;
-            ++j;
-        }
-        i += j;
-        return true;
-    }
-
-    // Parse number when one is expected
-    // Implements JSON number grammar:
-    // -? (0|[1-9][0-9]*) (.[0-9]+)? ([eE][+-]?[0-9]+)?
-    bool parse_number_token(const std::string& s, size_t& i)
-    {
-        if (i >= s.size())
-            return false;
-
-        if (s[i] == '-')
-            ++i;
-
-        if (i >= s.size())
-            return false;
-
-        if (s[i] == '0')
-        {
-            ++i;
-        }
-        else if (s[i] >= '1' && s[i] <= '9')
-        {
-            ++i;
-            while (i < s.size() && std::isdigit(static_cast<unsigned char>(s[i])))
-                ++i;
-        }
-        else
-        {
-            return false;
-        }
-
-        // Check fraction
-        if (i < s.size() && s[i] == '.')
-        {
-            ++i;
-            if (i >= s.size() || !std::isdigit(static_cast<unsigned char>(s[i])))
-                return false;
-            while (i < s.size() && std::isdigit(static_cast<unsigned char>(s[i])))
-                ++i;
-        }
-
-        // Check exponent
-        if (i < s.size() && (s[i] == 'e' || s[i] == 'E'))
-        {
-            ++i;
-            if (i < s.size() && (s[i] == '+' || s[i] == '-'))
-                ++i;
-            if (i >= s.size() || !std::isdigit(static_cast<unsigned char>(s[i])))
-                return false;
-            while (i < s.size() && std::isdigit(static_cast<unsigned char>(s[i])))
-                ++i;
-        }
-
-        return true;
-    }
-
-    // Jump cursor to 1 character after the value
-    bool skip_value(const std::string& s, size_t& i)
-    {
-        skip_ws(s, i);
-        if (i >= s.size())
-            return false;
-
-        char c = s[i];
-
-        // Advance the cursor past the value
-        switch (c)
-        {
-            // Start (or end) of a string
-        case '"':
-            return parse_string(s, i);
-
-            // Start of block
-        case '{':
-        {
-            ++i;
-            skip_ws(s, i);
-
-            if (i < s.size() && s[i] == '}')
-            {
-                ++i;
-                return true;
-            }
-
-            while (i < s.size())
-            {
-                // Parse key string first
-                if (!parse_string(s, i))
-                    return false;
-
-                skip_ws(s, i);
-                if (i >= s.size() || s[i] != ':')
-                    return false;
-                ++i;
-
-                if (!skip_value(s, i))
-                    return false;
-
-                skip_ws(s, i);
-                if (i >= s.size())
-                    return false;
-
-                if (s[i] == ',')
-                {
-                    ++i;
-                    skip_ws(s, i);
-                    continue;
-                }
-
-                if (s[i] == '}')
-                {
-                    ++i;
-                    return true;
-                }
-
-                return false;
-            }
-            return false;
-        }
-
-        // Start of array
-        case '[':
-        {
-            ++i;
-            skip_ws(s, i);
-
-            if (i < s.size() && s[i] == ']')
-            {
-                ++i;
-                return true;
-            }
-
-            while (i < s.size())
-            {
-                if (!skip_value(s, i))
-                    return false;
-
-                skip_ws(s, i);
-                if (i >= s.size())
-                    return false;
-
-                if (s[i] == ',')
-                {
-                    ++i;
-                    skip_ws(s, i);
-                    continue;
-                }
-
-                if (s[i] == ']')
-                {
-                    ++i;
-                    return true;
-                }
-
-                return false;
-            }
-            return false;
-        }
-
-        // Check for common non-string terms
-        case 't':
-            return parse_literal(s, i, "true");
-        case 'f':
-            return parse_literal(s, i, "false");
-        case 'n':
-            return parse_literal(s, i, "null");
-        default:
-            break;
-        }
-
-        // Assume number if not string/object/array/literal
-        return parse_number_token(s, i);
-    }
-
     // Ensure a string is exactly one valid JSON value
-    bool is_complete_json_value(const std::string& s)
+    bool is_complete_json_value(std::string_view s)
     {
         size_t i = 0;
-        skip_ws(s, i);
+        json_scan::skip_ws(s, i);
         if (i >= s.size())
             return false;
 
-        if (!skip_value(s, i))
+        if (!json_scan::skip_value(s, i))
             return false;
 
-        skip_ws(s, i);
+        json_scan::skip_ws(s, i);
         return i == s.size();
     }
 
@@ -302,55 +46,6 @@ namespace
         has_field = true;
     }
 
-    // Writes a JSON-escaped string into the output buffer
-    // Example output: "textDocument/completion"
-    void append_escaped_json_string(const std::string& value, std::string& out)
-    {
-        static const char hex[] = "0123456789ABCDEF";
-
-        out.push_back('"');
-        for (unsigned char c : value)
-        {
-            switch (c)
-            {
-            case '"':
-                out += "\\\"";
-                break;
-            case '\\':
-                out += "\\\\";
-                break;
-            case '\b':
-                out += "\\b";
-                break;
-            case '\f':
-                out += "\\f";
-                break;
-            case '\n':
-                out += "\\n";
-                break;
-            case '\r':
-                out += "\\r";
-                break;
-            case '\t':
-                out += "\\t";
-                break;
-            default:
-                if (c < 0x20)
-                {
-                    out += "\\u00";
-                    out.push_back(hex[(c >> 4) & 0x0F]);
-                    out.push_back(hex[c & 0x0F]);
-                }
-                else
-                {
-                    out.push_back(static_cast<char>(c));
-                }
-                break;
-            }
-        }
-        out.push_back('"');
-    }
-
     // Validates combinations of optional fields for strict JSON-RPC shapes
     bool has_valid_message_shape(const Message& msg)
     {
@@ -380,102 +75,178 @@ namespace
         return is_request || is_notification || is_success_response || is_error_response;
     }
 
-    bool serialiseMessage(const Message& msg, std::string& out_json)
+} // namespace
+
+// Writes a JSON-escaped string into the output buffer
+// Example output: "textDocument/completion"
+void appendEscapedJsonString(std::string_view value, std::string& out)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    // Worst case every byte becomes \u00XX, so nothing below reallocates
+    out.reserve(out.size() + value.size() * 6 + 2);
+
+    out.push_back('"');
+    size_t i = 0;
+    while (i < value.size())
     {
-        // Protocol version is always required and must be exactly 2.0
-        if (msg.jsonrpc != 2.0f)
-            return false;
+        // Everything up to the next byte needing an escape goes across in one copy
+        size_t special = json_scan::find_special(value, i);
+        out.append(value.data() + i, special - i);
+        if (special == value.size())
+            break;
 
-        // Reject any invalid message combinations before building output
-        if (!has_valid_message_shape(msg))
-            return false;
+        unsigned char c = static_cast<unsigned char>(value[special]);
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\b':
+            out += "\\b";
+            break;
+        case '\f':
+            out += "\\f";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            out += "\\u00";
+            out.push_back(hex[(c >> 4) & 0x0F]);
+            out.push_back(hex[c & 0x0F]);
+            break;
+        }
+        i = special + 1;
+    }
+    out.push_back('"');
+}
 
-        // Validate raw JSON fragments before writing them into body
-        if (msg.params_json.has_value() && !is_complete_json_value(*msg.params_json))
-            return false;
-        if (msg.result.has_value() && !is_complete_json_value(*msg.result))
-            return false;
-        if (msg.error.has_value() && !is_complete_json_value(*msg.error))
-            return false;
+void appendRequestId(const RequestId& id, std::string& out)
+{
+    if (id.is_string())
+    {
+        appendEscapedJsonString(id.text(), out);
+        return;
+    }
 
-        // Build into local buffer so caller output stays untouched on failure
-        std::string body;
+    char digits[24];
+    std::to_chars_result r = std::to_chars(digits, digits + sizeof(digits), id.number());
+    out.append(digits, r.ptr);
+}
 
-        // Change to match typical "small message" size
-        body.reserve(128);
-        body.push_back('{');
+bool serialiseMessage(const Message& msg, std::string& out_json)
+{
+    // Reject any invalid message combinations before building output
+    if (!has_valid_message_shape(msg))
+        return false;
 
-        bool has_field = false;
+    // Validate raw JSON fragments before writing them into body
+    // Nothing below can fail, so caller output stays untouched on failure
+    if (msg.params_json.has_value() && !is_complete_json_value(*msg.params_json))
+        return false;
+    if (msg.result.has_value() && !is_complete_json_value(*msg.result))
+        return false;
+    if (msg.error.has_value() && !is_complete_json_value(*msg.error))
+        return false;
 
-        // Always include protocol version first
-        append_field_prefix(body, has_field);
-        append_escaped_json_string("jsonrpc", body);
-        body.push_back(':');
-        append_escaped_json_string("2.0", body);
+    // Build straight into the caller's buffer, so pooled buffers keep their capacity
+    std::string& body = out_json;
+    body.clear();
 
-        // Stable field order for deterministic output
-        if (msg.id.has_value())
-        {
-            append_field_prefix(body, has_field);
-            append_escaped_json_string("id", body);
-            body.push_back(':');
-            body += std::to_string(*msg.id);
-        }
+    // Change to match typical "small message" size
+    body.reserve(128);
+    body.push_back('{');
 
-        if (msg.method.has_value())
-        {
-            append_field_prefix(body, has_field);
-            append_escaped_json_string("method", body);
-            body.push_back(':');
-            append_escaped_json_string(*msg.method, body);
-        }
+    bool has_field = false;
 
-        if (msg.params_json.has_value())
-        {
-            append_field_prefix(body, has_field);
-            append_escaped_json_string("params", body);
-            body.push_back(':');
-            body += *msg.params_json;
-        }
+    // Always include protocol version first
+    append_field_prefix(body, has_field);
+    appendEscapedJsonString("jsonrpc", body);
+    body.push_back(':');
+    appendEscapedJsonString("2.0", body);
 
-        if (msg.result.has_value())
-        {
-            append_field_prefix(body, has_field);
-            append_escaped_json_string("result", body);
-            body.push_back(':');
-            body += *msg.result;
-        }
+    // Stable field order for deterministic output
+    if (msg.id.has_value())
+    {
+        append_field_prefix(body, has_field);
+        appendEscapedJsonString("id", body);
+        body.push_back(':');
+        appendRequestId(*msg.id, body);
+    }
 
-        if (msg.error.has_value())
-        {
-            append_field_prefix(body, has_field);
-            append_escaped_json_string("error", body);
-            body.push_back(':');
-            body += *msg.error;
-        }
+    if (msg.method.has_value())
+    {
+        append_field_prefix(body, has_field);
+        appendEscapedJsonString("method", body);
+        body.push_back(':');
+        appendEscapedJsonString(*msg.method, body);
+    }
+
+    if (msg.params_json.has_value())
+    {
+        append_field_prefix(body, has_field);
+        appendEscapedJsonString("params", body);
+        body.push_back(':');
+        body += *msg.params_json;
+    }
 
-        body.push_back('}');
-        out_json = body;
-        return true;
+    if (msg.result.has_value())
+    {
+        append_field_prefix(body, has_field);
+        appendEscapedJsonString("result", body);
+        body.push_back(':');
+        body += *msg.result;
     }
 
-} // namespace
+    if (msg.error.has_value())
+    {
+        append_field_prefix(body, has_field);
+        appendEscapedJsonString("error", body);
+        body.push_back(':');
+        body += *msg.error;
+    }
+
+    body.push_back('}');
+    return true;
+}
+
+size_t writeLspHeader(size_t body_size, char* out, size_t capacity)
+{
+    int written = std::snprintf(out, capacity,
+        "Content-Length: %zu\r\n"
+        "Content-Type: application/vscode-jsonrpc; charset=utf-8\r\n"
+        "\r\n",
+        body_size);
+    if (written < 0 || static_cast<size_t>(written) >= capacity)
+        return 0;
+    return static_cast<size_t>(written);
+}
 
 bool serialiseLspPacket(const Message& msg, std::string& out_packet)
 {
-    std::string json_body;
+    // Body is built in a reused scratch buffer, then copied once behind the header
+    thread_local std::string json_body;
     if (!serialiseMessage(msg, json_body))
         return false;
 
-    std::string packet;
-    packet.reserve(json_body.size() + 96);
-    packet += "Content-Length: ";
-    packet += std::to_string(json_body.size());
-    packet += "\r\n";
-    packet += "Content-Type: application/vscode-jsonrpc; charset=utf-8\r\n";
-    packet += "\r\n";
-    packet += json_body;
+    char header[kLspHeaderCapacity];
+    size_t header_size = writeLspHeader(json_body.size(), header, sizeof(header));
+    if (header_size == 0)
+        return false;
 
-    out_packet = packet;
+    out_packet.clear();
+    out_packet.reserve(header_size + json_body.size());
+    out_packet.append(header, header_size);
+    out_packet += json_body;
     return true;
 }
@@ -0,0 +1,594 @@
+#include "headers/JSON-scan.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JSON_SCAN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// Shared JSON lexing
+// JSON-tape.cpp builds its index on top of these, and anything that needs to walk raw JSON
+// without building an index (validation, skipping unwanted values) should use them directly
+
+// didOpen/didChange bodies are mostly one huge string holding the whole file, so string scanning
+// and whitespace skipping are vectorised: a block of bytes is compared at once against the
+// characters that end a clean run ('"', '\\', control characters), and the clean runs are
+// skipped/copied in bulk
+
+namespace
+{
+    // Bytes that end a clean run inside a string
+    struct SpecialTable
+    {
+        bool special[256] = {};
+
+        SpecialTable()
+        {
+            for (int c = 0; c < 0x20; ++c)
+                special[c] = true;
+            special[static_cast<unsigned char>('"')] = true;
+            special[static_cast<unsigned char>('\\')] = true;
+        }
+    };
+
+    const SpecialTable special_table;
+
+    size_t find_special_scalar(const char *p, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (special_table.special[static_cast<unsigned char>(p[i])])
+                return i;
+        }
+        return n;
+    }
+
+#ifdef JSON_SCAN_X86
+#if defined(__GNUC__) || defined(__clang__)
+#define JSON_SCAN_AVX2 __attribute__((target("avx2")))
+#else
+#define JSON_SCAN_AVX2
+#endif
+
+    unsigned first_set_bit(unsigned mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index = 0;
+        _BitScanForward(&index, mask);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+    // SSE2 is part of x86-64, so this is the baseline vector path
+    size_t find_special_sse2(const char *p, size_t n)
+    {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1F);
+
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            // min(v, 0x1F) == v  <=>  v <= 0x1F (unsigned)
+            __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                        _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+            if (mask != 0)
+                return i + first_set_bit(mask);
+        }
+        return i + find_special_scalar(p + i, n - i);
+    }
+
+    JSON_SCAN_AVX2 size_t find_special_avx2(const char *p, size_t n)
+    {
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const __m256i control = _mm256_set1_epi8(0x1F);
+
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+            __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                                           _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+            if (mask != 0)
+                return i + first_set_bit(mask);
+        }
+        return i + find_special_sse2(p + i, n - i);
+    }
+
+    bool cpu_has_avx2()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        // AVX + OSXSAVE, and the OS saves the YMM registers
+        __cpuid(info, 1);
+        if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+            return false;
+        if ((_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    using FindSpecialFn = size_t (*)(const char *, size_t);
+
+    // Picked once at startup
+    FindSpecialFn select_find_special()
+    {
+#ifdef JSON_SCAN_X86
+        if (cpu_has_avx2())
+            return find_special_avx2;
+        return find_special_sse2;
+#else
+        return find_special_scalar;
+#endif
+    }
+
+    const FindSpecialFn find_special_impl = select_find_special();
+
+    bool is_ws(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    bool is_digit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    bool hex_value(char h, unsigned &v)
+    {
+        if (h >= '0' && h <= '9')
+            v = static_cast<unsigned>(h - '0');
+        else if (h >= 'a' && h <= 'f')
+            v = static_cast<unsigned>(10 + (h - 'a'));
+        else if (h >= 'A' && h <= 'F')
+            v = static_cast<unsigned>(10 + (h - 'A'));
+        else
+            return false;
+        return true;
+    }
+
+    // Reads the 4 hex digits of a \u escape starting at i
+    bool parse_hex4(std::string_view s, size_t i, unsigned &code)
+    {
+        if (i + 4 > s.size())
+            return false;
+
+        code = 0;
+        for (size_t j = 0; j < 4; ++j)
+        {
+            unsigned v = 0;
+            if (!hex_value(s[i + j], v))
+                return false;
+            code = (code << 4U) | v;
+        }
+        return true;
+    }
+
+    // Writes code point cp as UTF-8, returns the new end
+    char *append_utf8(char *dst, unsigned cp)
+    {
+        if (cp < 0x80)
+        {
+            *dst++ = static_cast<char>(cp);
+        }
+        else if (cp < 0x800)
+        {
+            *dst++ = static_cast<char>(0xC0 | (cp >> 6));
+            *dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            *dst++ = static_cast<char>(0xE0 | (cp >> 12));
+            *dst++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            *dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            *dst++ = static_cast<char>(0xF0 | (cp >> 18));
+            *dst++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            *dst++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            *dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        return dst;
+    }
+
+    constexpr unsigned kReplacementChar = 0xFFFD;
+
+    bool skip_value_at_depth(std::string_view s, size_t &i, size_t depth);
+
+    bool skip_container(std::string_view s, size_t &i, size_t depth, char close, bool is_object)
+    {
+        if (depth >= json_scan::kMaxDepth)
+            return false;
+
+        ++i;
+        json_scan::skip_ws(s, i);
+
+        if (i < s.size() && s[i] == close)
+        {
+            ++i;
+            return true;
+        }
+
+        while (i < s.size())
+        {
+            if (is_object)
+            {
+                // Key, then separator
+                bool escaped = false;
+                if (!json_scan::scan_string(s, i, escaped))
+                    return false;
+
+                json_scan::skip_ws(s, i);
+                if (i >= s.size() || s[i] != ':')
+                    return false;
+                ++i;
+            }
+
+            if (!skip_value_at_depth(s, i, depth + 1))
+                return false;
+
+            json_scan::skip_ws(s, i);
+            if (i >= s.size())
+                return false;
+
+            // More values to go
+            if (s[i] == ',')
+            {
+                ++i;
+                json_scan::skip_ws(s, i);
+                continue;
+            }
+
+            // Correct end of block check
+            if (s[i] == close)
+            {
+                ++i;
+                return true;
+            }
+
+            // Missing separator / end of block
+            return false;
+        }
+        return false;
+    }
+
+    bool skip_value_at_depth(std::string_view s, size_t &i, size_t depth)
+    {
+        json_scan::skip_ws(s, i);
+        if (i >= s.size())
+            return false;
+
+        switch (s[i])
+        {
+        case '"':
+        {
+            bool escaped = false;
+            return json_scan::scan_string(s, i, escaped);
+        }
+        case '{':
+            return skip_container(s, i, depth, '}', true);
+        case '[':
+            return skip_container(s, i, depth, ']', false);
+        case 't':
+            return json_scan::parse_literal(s, i, "true");
+        case 'f':
+            return json_scan::parse_literal(s, i, "false");
+        case 'n':
+            return json_scan::parse_literal(s, i, "null");
+        default:
+            return json_scan::scan_number(s, i);
+        }
+    }
+}
+
+namespace json_scan
+{
+    void skip_ws(std::string_view s, size_t &i)
+    {
+        // Minified JSON has little or no whitespace, so check the first few bytes before doing any block work
+        for (size_t end = i + 8; i < s.size() && i < end; ++i)
+        {
+            if (!is_ws(s[i]))
+                return;
+        }
+
+#ifdef JSON_SCAN_X86
+        // Long runs (pretty-printed indentation), 16 bytes at a time
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i newline = _mm_set1_epi8('\n');
+        const __m128i carriage = _mm_set1_epi8('\r');
+        const __m128i tab = _mm_set1_epi8('\t');
+        while (i + 16 <= s.size())
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s.data() + i));
+            __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, newline)),
+                                      _mm_or_si128(_mm_cmpeq_epi8(v, carriage), _mm_cmpeq_epi8(v, tab)));
+            unsigned other = ~static_cast<unsigned>(_mm_movemask_epi8(ws)) & 0xFFFFU;
+            if (other != 0)
+            {
+                i += first_set_bit(other);
+                return;
+            }
+            i += 16;
+        }
+#endif
+
+        while (i < s.size() && is_ws(s[i]))
+            ++i;
+    }
+
+    size_t find_special(std::string_view s, size_t i)
+    {
+        if (i >= s.size())
+            return s.size();
+        return i + find_special_impl(s.data() + i, s.size() - i);
+    }
+
+    bool scan_string(std::string_view s, size_t &i, bool &escaped)
+    {
+        if (i >= s.size() || s[i] != '"')
+            return false;
+
+        size_t j = i + 1;
+        escaped = false;
+
+        while (j < s.size())
+        {
+            // Jump over the clean run up to the next interesting byte
+            j = find_special(s, j);
+            if (j >= s.size())
+                break;
+
+            unsigned char c = static_cast<unsigned char>(s[j++]);
+
+            if (c == '"')
+            {
+                i = j;
+                return true;
+            }
+
+            // Reject unescaped control characters
+            if (c < 0x20)
+                return false;
+
+            escaped = true;
+            if (j >= s.size())
+                return false;
+
+            switch (s[j++])
+            {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                break;
+            case 'u':
+            {
+                unsigned code = 0;
+                if (!parse_hex4(s, j, code))
+                    return false;
+                j += 4;
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+
+        // If the closing '"' is missing, malformed JSON string
+        return false;
+    }
+
+    bool decode_string(std::string_view raw, std::string &out)
+    {
+        out.resize(raw.size());
+        size_t size = 0;
+        if (!decode_string(raw, &out[0], size))
+        {
+            out.clear();
+            return false;
+        }
+        out.resize(size);
+        return true;
+    }
+
+    bool decode_string(std::string_view raw, char *out, size_t &out_size)
+    {
+        char *dst = out;
+        size_t i = 0;
+        while (i < raw.size())
+        {
+            // raw has been through scan_string, so the only special bytes left are backslashes
+            size_t run_end = find_special(raw, i);
+            std::memcpy(dst, raw.data() + i, run_end - i);
+            dst += run_end - i;
+            i = run_end;
+            if (i >= raw.size())
+                break;
+
+            if (raw[i++] != '\\' || i >= raw.size())
+                return false;
+
+            // Decodes JSON escape sequences -> ASCII escapes
+            char esc = raw[i++];
+            switch (esc)
+            {
+            case '"':
+            case '\\':
+            case '/':
+                *dst++ = esc;
+                break;
+            case 'b':
+                *dst++ = '\b';
+                break;
+            case 'f':
+                *dst++ = '\f';
+                break;
+            case 'n':
+                *dst++ = '\n';
+                break;
+            case 'r':
+                *dst++ = '\r';
+                break;
+            case 't':
+                *dst++ = '\t';
+                break;
+            case 'u':
+            {
+                unsigned code = 0;
+                if (!parse_hex4(raw, i, code))
+                    return false;
+                i += 4;
+
+                // \uXXXX is UTF-16, characters outside the BMP come as a high + low surrogate pair
+                // Unpaired surrogates can't be written as UTF-8, so they become U+FFFD
+                if (code >= 0xD800 && code <= 0xDBFF)
+                {
+                    unsigned low = 0;
+                    if (i + 6 <= raw.size() && raw[i] == '\\' && raw[i + 1] == 'u' && parse_hex4(raw, i + 2, low) &&
+                        low >= 0xDC00 && low <= 0xDFFF)
+                    {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    }
+                    else
+                    {
+                        code = kReplacementChar;
+                    }
+                }
+                else if (code >= 0xDC00 && code <= 0xDFFF)
+                {
+                    code = kReplacementChar;
+                }
+
+                // At most 4 bytes for 6 (or 12) bytes of escape, so the output still never outgrows raw
+                dst = append_utf8(dst, code);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+
+        out_size = static_cast<size_t>(dst - out);
+        return true;
+    }
+
+    bool parse_literal(std::string_view s, size_t &i, std::string_view literal)
+    {
+        if (s.substr(i, literal.size()) != literal)
+            return false;
+        i += literal.size();
+        return true;
+    }
+
+    bool scan_number(std::string_view s, size_t &i)
+    {
+        size_t j = i;
+
+        if (j < s.size() && s[j] == '-')
+            ++j;
+
+        if (j >= s.size())
+            return false;
+
+        if (s[j] == '0')
+        {
+            ++j;
+        }
+        else if (s[j] >= '1' && s[j] <= '9')
+        {
+            ++j;
+            while (j < s.size() && is_digit(s[j]))
+                ++j;
+        }
+        else
+        {
+            return false;
+        }
+
+        // Check fraction
+        if (j < s.size() && s[j] == '.')
+        {
+            ++j;
+            if (j >= s.size() || !is_digit(s[j]))
+                return false;
+            while (j < s.size() && is_digit(s[j]))
+                ++j;
+        }
+
+        // Check exponent
+        if (j < s.size() && (s[j] == 'e' || s[j] == 'E'))
+        {
+            ++j;
+            if (j < s.size() && (s[j] == '+' || s[j] == '-'))
+                ++j;
+            if (j >= s.size() || !is_digit(s[j]))
+                return false;
+            while (j < s.size() && is_digit(s[j]))
+                ++j;
+        }
+
+        i = j;
+        return true;
+    }
+
+    bool to_double(std::string_view token, double &out)
+    {
+        const char *last = token.data() + token.size();
+        std::from_chars_result r = std::from_chars(token.data(), last, out);
+        return r.ec == std::errc() && r.ptr == last;
+    }
+
+    bool to_integer(std::string_view token, long long &out)
+    {
+        // Plain integers (nearly every id, line and character) never leave this path
+        const char *last = token.data() + token.size();
+        std::from_chars_result r = std::from_chars(token.data(), last, out);
+        if (r.ec == std::errc() && r.ptr == last)
+            return true;
+        if (r.ec != std::errc() || (*r.ptr != '.' && *r.ptr != 'e' && *r.ptr != 'E'))
+            return false;
+
+        // Fraction or exponent, allowed if it is really an integer
+        double value = 0;
+        if (!to_double(token, value) || value != std::floor(value))
+            return false;
+        if (value < -9223372036854775808.0 || value >= 9223372036854775808.0)
+            return false;
+        out = static_cast<long long>(value);
+        return true;
+    }
+
+    bool skip_value(std::string_view s, size_t &i)
+    {
+        return skip_value_at_depth(s, i, 0);
+    }
+}
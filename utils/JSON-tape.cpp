@@ -0,0 +1,233 @@
+#include "headers/JSON-tape.h"
+#include "headers/JSON-scan.h"
+
+/*
+Tape (index) over a JSON body
+
+The body is tokenised once into a flat array of nodes, which storeMessage reads the envelope fields from.
+params is only kept as a view of its span, each handler decodes the fields it needs from that itself.
+
+{"id":1,"params":{"a":[true]}}
+
+0  Object  count=2 next=8
+1  String  "id"
+2  Number  1
+3  String  "params"
+4  Object  count=1 next=8
+5  String  "a"
+6  Array   count=1 next=8
+7  True
+*/
+
+namespace
+{
+    bool build_node(std::string_view s, size_t &i, std::vector<TapeNode> &nodes, size_t depth);
+
+    size_t push_node(std::vector<TapeNode> &nodes, TapeType type, size_t begin, size_t end)
+    {
+        TapeNode node;
+        node.type = type;
+        node.begin = static_cast<uint32_t>(begin);
+        node.end = static_cast<uint32_t>(end);
+        nodes.push_back(node);
+        return nodes.size() - 1;
+    }
+
+    bool build_string(std::string_view s, size_t &i, std::vector<TapeNode> &nodes)
+    {
+        size_t start = i;
+        bool escaped = false;
+        if (!json_scan::scan_string(s, i, escaped))
+            return false;
+
+        // Contents only, without the quotes
+        size_t index = push_node(nodes, TapeType::String, start + 1, i - 1);
+        nodes[index].escaped = escaped;
+        nodes[index].next = static_cast<uint32_t>(index + 1);
+        return true;
+    }
+
+    bool build_container(std::string_view s, size_t &i, std::vector<TapeNode> &nodes, size_t depth, bool is_object)
+    {
+        if (depth >= json_scan::kMaxDepth)
+            return false;
+
+        const char close = is_object ? '}' : ']';
+        size_t index = push_node(nodes, is_object ? TapeType::Object : TapeType::Array, i, i);
+        uint32_t count = 0;
+
+        ++i;
+        json_scan::skip_ws(s, i);
+
+        if (i < s.size() && s[i] == close)
+        {
+            ++i;
+        }
+        else
+        {
+            while (true)
+            {
+                if (is_object)
+                {
+                    // Key, then separator
+                    json_scan::skip_ws(s, i);
+                    if (!build_string(s, i, nodes))
+                        return false;
+
+                    json_scan::skip_ws(s, i);
+                    if (i >= s.size() || s[i] != ':')
+                        return false;
+                    ++i;
+                }
+
+                if (!build_node(s, i, nodes, depth + 1))
+                    return false;
+                ++count;
+
+                json_scan::skip_ws(s, i);
+                if (i >= s.size())
+                    return false;
+
+                if (s[i] == ',')
+                {
+                    ++i;
+                    continue;
+                }
+
+                if (s[i] == close)
+                {
+                    ++i;
+                    break;
+                }
+
+                // Missing separator / end of block
+                return false;
+            }
+        }
+
+        // nodes may have been reallocated by the children
+        nodes[index].end = static_cast<uint32_t>(i);
+        nodes[index].count = count;
+        nodes[index].next = static_cast<uint32_t>(nodes.size());
+        return true;
+    }
+
+    bool build_node(std::string_view s, size_t &i, std::vector<TapeNode> &nodes, size_t depth)
+    {
+        json_scan::skip_ws(s, i);
+        if (i >= s.size())
+            return false;
+
+        size_t start = i;
+        TapeType type = TapeType::Null;
+
+        switch (s[i])
+        {
+        case '"':
+            return build_string(s, i, nodes);
+        case '{':
+            return build_container(s, i, nodes, depth, true);
+        case '[':
+            return build_container(s, i, nodes, depth, false);
+        case 't':
+            if (!json_scan::parse_literal(s, i, "true"))
+                return false;
+            type = TapeType::True;
+            break;
+        case 'f':
+            if (!json_scan::parse_literal(s, i, "false"))
+                return false;
+            type = TapeType::False;
+            break;
+        case 'n':
+            if (!json_scan::parse_literal(s, i, "null"))
+                return false;
+            type = TapeType::Null;
+            break;
+        default:
+            if (!json_scan::scan_number(s, i))
+                return false;
+            type = TapeType::Number;
+            break;
+        }
+
+        size_t index = push_node(nodes, type, start, i);
+        nodes[index].next = static_cast<uint32_t>(index + 1);
+        return true;
+    }
+}
+
+bool buildTape(std::string_view json, JsonTape &out)
+{
+    out.source = json;
+    out.nodes.clear();
+
+    // Offsets are stored as 32 bits, the framing layer caps bodies well below this
+    if (json.size() > UINT32_MAX)
+        return false;
+
+    size_t i = 0;
+    if (!build_node(json, i, out.nodes, 0))
+        return false;
+
+    // Exactly one value per document
+    json_scan::skip_ws(json, i);
+    return i == json.size();
+}
+
+size_t tapeFindMember(const JsonTape &tape, size_t object, std::string_view key)
+{
+    if (object >= tape.nodes.size() || tape.nodes[object].type != TapeType::Object)
+        return kNoTapeNode;
+
+    std::string decoded;
+    size_t found = kNoTapeNode;
+    size_t node = object + 1;
+    for (uint32_t m = 0; m < tape.nodes[object].count; ++m)
+    {
+        const TapeNode &name = tape.nodes[node];
+        size_t value = node + 1;
+
+        bool match = false;
+        if (!name.escaped)
+            match = tapeRaw(tape, node) == key;
+        else if (tapeString(tape, node, decoded))
+            match = decoded == key;
+
+        // Later duplicates win, same as the old map based decoders
+        if (match)
+            found = value;
+
+        node = tape.nodes[value].next;
+    }
+    return found;
+}
+
+std::string_view tapeRaw(const JsonTape &tape, size_t node)
+{
+    const TapeNode &n = tape.nodes[node];
+    return tape.source.substr(n.begin, n.end - n.begin);
+}
+
+bool tapeString(const JsonTape &tape, size_t node, std::string &out)
+{
+    if (tape.nodes[node].type != TapeType::String)
+        return false;
+
+    std::string_view raw = tapeRaw(tape, node);
+    if (!tape.nodes[node].escaped)
+    {
+        out.assign(raw.data(), raw.size());
+        return true;
+    }
+    return json_scan::decode_string(raw, out);
+}
+
+bool tapeNumber(const JsonTape &tape, size_t node, double &out)
+{
+    if (tape.nodes[node].type != TapeType::Number)
+        return false;
+
+    // Token was validated by json_scan::scan_number, and is parsed where it sits
+    return json_scan::to_double(tapeRaw(tape, node), out);
+}
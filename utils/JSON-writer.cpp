@@ -0,0 +1,118 @@
+#include "headers/JSON-writer.h"
+#include "headers/JSON-encode.h"
+
+#include <charconv>
+#include <cmath>
+
+void JsonWriter::reset(std::string &buffer)
+{
+    out = &buffer;
+    has_member.clear();
+    after_key = false;
+}
+
+// Puts the ',' between siblings, values straight after a key need nothing
+void JsonWriter::separate()
+{
+    if (after_key)
+    {
+        after_key = false;
+        return;
+    }
+    if (!has_member.empty())
+    {
+        if (has_member.back())
+            out->push_back(',');
+        has_member.back() = true;
+    }
+}
+
+void JsonWriter::begin_object()
+{
+    separate();
+    out->push_back('{');
+    has_member.push_back(false);
+}
+
+void JsonWriter::end_object()
+{
+    has_member.pop_back();
+    out->push_back('}');
+}
+
+void JsonWriter::begin_array()
+{
+    separate();
+    out->push_back('[');
+    has_member.push_back(false);
+}
+
+void JsonWriter::end_array()
+{
+    has_member.pop_back();
+    out->push_back(']');
+}
+
+void JsonWriter::key(std::string_view name)
+{
+    separate();
+    appendEscapedJsonString(name, *out);
+    out->push_back(':');
+    after_key = true;
+}
+
+void JsonWriter::string(std::string_view value)
+{
+    separate();
+    appendEscapedJsonString(value, *out);
+}
+
+void JsonWriter::value(bool value)
+{
+    separate();
+    out->append(value ? "true" : "false");
+}
+
+void JsonWriter::value(double value)
+{
+    // JSON has no NaN / Infinity
+    if (!std::isfinite(value))
+    {
+        null();
+        return;
+    }
+
+    // Shortest text that reads back as the same double, and never locale dependent (no decimal commas)
+    separate();
+    char digits[32];
+    std::to_chars_result r = std::to_chars(digits, digits + sizeof(digits), value);
+    out->append(digits, r.ptr);
+}
+
+void JsonWriter::write_integer(long long value)
+{
+    separate();
+    char digits[24];
+    std::to_chars_result r = std::to_chars(digits, digits + sizeof(digits), value);
+    out->append(digits, r.ptr);
+}
+
+void JsonWriter::write_unsigned(unsigned long long value)
+{
+    separate();
+    char digits[24];
+    std::to_chars_result r = std::to_chars(digits, digits + sizeof(digits), value);
+    out->append(digits, r.ptr);
+}
+
+void JsonWriter::null()
+{
+    separate();
+    out->append("null");
+}
+
+void JsonWriter::raw(std::string_view json)
+{
+    separate();
+    out->append(json.data(), json.size());
+}
@@ -0,0 +1,160 @@
+#include "headers/analysis-pipeline.h"
+#include "headers/lsp-methods.h"
+
+#include <utility>
+#include <vector>
+
+AnalysisPipeline::AnalysisPipeline(DocumentStore &documents, RequestExecutor &executor, ResponseSequencer &responses,
+                                   Analyser analyser, DebounceWindows windows)
+    : documents(documents), executor(executor), responses(responses), analyser(std::move(analyser)),
+      windows(windows), timer([this] { timer_loop(); })
+{
+}
+
+AnalysisPipeline::~AnalysisPipeline()
+{
+    stop();
+}
+
+void AnalysisPipeline::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        for (auto &[uri, entry] : entries)
+        {
+            if (entry.running)
+                entry.running->store(true, std::memory_order_relaxed);
+        }
+        entries.clear();
+    }
+    wake.notify_all();
+    if (timer.joinable())
+        timer.join();
+}
+
+void AnalysisPipeline::changed(const std::string &uri)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping)
+            return;
+
+        Clock::time_point now = Clock::now();
+        Entry &entry = entries[uri];
+        if (!entry.pending)
+        {
+            entry.pending = true;
+            entry.first_edit = now;
+        }
+        entry.last_edit = now;
+
+        // Whatever is being analysed right now is an older version
+        if (entry.running)
+            entry.running->store(true, std::memory_order_relaxed);
+    }
+    wake.notify_one();
+}
+
+void AnalysisPipeline::closed(const std::string &uri)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(uri);
+    if (found == entries.end())
+        return;
+
+    if (found->second.running)
+        found->second.running->store(true, std::memory_order_relaxed);
+    entries.erase(found);
+}
+
+// Sleeps until the earliest document is due, hands every due document to the executor, and goes round again
+void AnalysisPipeline::timer_loop()
+{
+    std::vector<std::pair<std::string, std::shared_ptr<std::atomic<bool>>>> due;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping)
+    {
+        Clock::time_point now = Clock::now();
+        Clock::time_point next = Clock::time_point::max();
+        for (auto &[uri, entry] : entries)
+        {
+            if (!entry.pending)
+                continue;
+
+            Clock::time_point at = std::min(entry.last_edit + windows.quiet, entry.first_edit + windows.max_delay);
+            if (at > now)
+            {
+                next = std::min(next, at);
+                continue;
+            }
+
+            entry.pending = false;
+            entry.running = std::make_shared<std::atomic<bool>>(false);
+            due.emplace_back(uri, entry.running);
+        }
+
+        if (!due.empty())
+        {
+            lock.unlock();
+            for (auto &[uri, superseded] : due)
+                executor.submit(PriorityLane::Background, [this, uri = std::move(uri), superseded = std::move(superseded)] {
+                    analyse(uri, superseded);
+                });
+            due.clear();
+            lock.lock();
+            continue;
+        }
+
+        if (next == Clock::time_point::max())
+            wake.wait(lock);
+        else
+            wake.wait_until(lock, next);
+    }
+}
+
+void AnalysisPipeline::analyse(const std::string &uri, const std::shared_ptr<std::atomic<bool>> &superseded)
+{
+    CancellationToken token(superseded.get());
+    if (token.cancelled())
+        return;
+
+    // Reused per worker, so analysing doesn't allocate once the buffers have grown
+    thread_local DocumentSnapshot snapshot;
+    thread_local std::string diagnostics;
+    if (!documents.snapshot(uri, snapshot))
+        return;
+
+    diagnostics.clear();
+    JsonWriter json(diagnostics);
+    json.begin_array();
+    bool ok = analyser(snapshot, token, json);
+    json.end_array();
+    if (!ok || token.cancelled())
+        return;
+
+    {
+        // Published under the pipeline's lock, so nothing goes out once stop() has returned,
+        // and only if this is still the newest analysis of the document
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = entries.find(uri);
+        if (stopping || found == entries.end() || found->second.running != superseded || token.cancelled())
+            return;
+        found->second.running.reset();
+
+        responses.notify(methodName(LspMethod::PublishDiagnostics), [&](JsonWriter &params) {
+            params.begin_object();
+            params.key("uri");
+            params.string(uri);
+            params.key("version");
+            params.value(snapshot.version);
+            params.key("diagnostics");
+            params.raw(diagnostics);
+            params.end_object();
+        });
+    }
+
+    // Nothing else may be about to flush, the main thread could be blocked reading
+    responses.flush();
+}
@@ -0,0 +1,106 @@
+#include "headers/batch-decode.h"
+#include "headers/JSON-scan.h"
+
+/*
+Batch:
+{json
+    [
+        {"jsonrpc": "2.0", "id": 1, "method": "textDocument/hover", "params": {...}},
+        {"jsonrpc": "2.0", "method": "textDocument/didOpen", "params": {...}},
+        ...
+    ]
+}
+
+Responses to the requests in a batch go back as one array, in the same order (see PacketWriter::begin_batch)
+Notifications get nothing, so a batch of only notifications gets no reply at all
+*/
+
+namespace
+{
+    // Small batches (a few startup notifications) decode faster on one thread than it takes to
+    // wake the workers, so they are only used once there is a decent amount of text to share out
+    constexpr size_t kParallelBatchBytes = 16 * 1024;
+}
+
+bool isBatch(std::string_view json)
+{
+    size_t i = 0;
+    json_scan::skip_ws(json, i);
+    return i < json.size() && json[i] == '[';
+}
+
+bool splitBatch(std::string_view json, std::vector<std::string_view> &out_elements)
+{
+    out_elements.clear();
+
+    size_t i = 0;
+    json_scan::skip_ws(json, i);
+    if (i >= json.size() || json[i] != '[')
+        return false;
+    ++i;
+
+    json_scan::skip_ws(json, i);
+    if (i < json.size() && json[i] == ']')
+    {
+        ++i;
+        json_scan::skip_ws(json, i);
+        return i == json.size();
+    }
+
+    while (i < json.size())
+    {
+        // Each element is skipped exactly once, its span is all that's kept
+        json_scan::skip_ws(json, i);
+        size_t start = i;
+        if (!json_scan::skip_value(json, i))
+            return false;
+        out_elements.push_back(json.substr(start, i - start));
+
+        json_scan::skip_ws(json, i);
+        if (i >= json.size())
+            return false;
+        if (json[i] == ',')
+        {
+            ++i;
+            continue;
+        }
+        if (json[i] != ']')
+            return false;
+
+        ++i;
+        json_scan::skip_ws(json, i);
+        return i == json.size();
+    }
+    return false;
+}
+
+bool decodeBatch(std::string_view json, BatchDecoder &out, RequestExecutor &executor)
+{
+    out.malformed = !splitBatch(json, out.elements);
+
+    // An empty batch is an invalid request as per JSON-RPC
+    if (out.malformed || out.elements.empty())
+        return false;
+
+    size_t count = out.elements.size();
+    if (out.tapes.size() < count)
+        out.tapes.resize(count);
+    out.messages.assign(count, Message{});
+    out.valid.assign(count, 0);
+
+    // Every element has its own tape and message slot, so the workers share nothing
+    auto decode = [&out](size_t i) {
+        out.valid[i] = storeMessage(out.elements[i], out.messages[i], out.tapes[i]) ? 1 : 0;
+    };
+
+    if (count > 1 && json.size() >= kParallelBatchBytes)
+    {
+        executor.parallel_for(count, decode);
+    }
+    else
+    {
+        for (size_t i = 0; i < count; ++i)
+            decode(i);
+    }
+    return true;
+}
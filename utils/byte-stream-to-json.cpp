@@ -1,7 +1,8 @@
 #include "headers/byte-stream-to-json.h"
 
-#include <unordered_map>
-#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 
 // Each Message is recieved via byte streams
 // We want JSON
@@ -14,94 +15,363 @@
 // Content-Type: string // Should be "application/ide-jsonrpc; charset=utf8" -- charset should always be set to utf-8
 // \r\n\r\n
 
-// Parse headers into a map
-static std::unordered_map<std::string, std::string>
-parse_headers(const std::string &header_block)
+namespace
 {
-    std::unordered_map<std::string, std::string> map;
-    std::istringstream ss(header_block);
-    std::string line;
-    while (std::getline(ss, line))
+    // Reusable arena that the byte stream is read into
+    // [0, head)        consumed by previous messages
+    // [head, tail)     read from the stream but not handed out yet
+    // [tail, capacity) free space for the next read
+    // Bodies are handed out as views into the arena, so they are never copied out of it
+    struct FrameBuffer
     {
-        if (!line.empty() && line.back() == '\r')
-            line.pop_back();
-        std::string::size_type pos = line.find(':');
-        if (pos == std::string::npos)
-            continue;
-        std::string key = line.substr(0, pos);
-        std::string val = line.substr(pos + 1);
-        if (!val.empty() && val[0] == ' ')
-            val.erase(0, 1);
-        map[key] = val;
+        std::unique_ptr<char[]> data;
+        size_t capacity = 0;
+        size_t head = 0;
+        size_t tail = 0;
+    };
+
+    constexpr size_t kInitialCapacity = 64 * 1024;
+    constexpr size_t kReadChunk = 16 * 1024;
+
+    FrameBuffer frame;
+
+    // Makes sure at least `needed` bytes are free after tail
+    // Consumed messages are dropped by moving head, so the only bytes that are ever relocated
+    // are the unread ones (at most one partial message), and only when the arena runs out of room
+    bool reserve_tail(FrameBuffer &buf, size_t needed)
+    {
+        if (buf.capacity - buf.tail >= needed)
+            return true;
+
+        size_t pending = buf.tail - buf.head;
+        if (needed > SIZE_MAX / 2 - pending)
+            return false;
+        size_t required = pending + needed;
+
+        if (required <= buf.capacity)
+        {
+            // Enough room once the consumed prefix is reclaimed
+            std::memmove(buf.data.get(), buf.data.get() + buf.head, pending);
+        }
+        else
+        {
+            size_t capacity = buf.capacity == 0 ? kInitialCapacity : buf.capacity;
+            while (capacity < required)
+                capacity *= 2;
+
+            std::unique_ptr<char[]> grown(new char[capacity]);
+            if (pending > 0)
+                std::memcpy(grown.get(), buf.data.get() + buf.head, pending);
+            buf.data = std::move(grown);
+            buf.capacity = capacity;
+        }
+
+        buf.head = 0;
+        buf.tail = pending;
+        return true;
+    }
+
+    // Reads at least `min_bytes` into the arena, plus whatever else the transport has ready
+    // Returns false when the input is closed/unreadable
+    bool fill(Transport &in, FrameBuffer &buf, size_t min_bytes)
+    {
+        if (!reserve_tail(buf, min_bytes < kReadChunk ? kReadChunk : min_bytes))
+            return false;
+
+        size_t count = in.read_some(buf.data.get() + buf.tail, min_bytes, buf.capacity - buf.tail);
+        buf.tail += count;
+        return count >= min_bytes;
+    }
+
+    // Header limits -- anything bigger than this is not a real LSP client
+    constexpr size_t kMaxHeaderBytes = 8 * 1024;
+    constexpr size_t kMaxFieldNameBytes = 64;
+    constexpr size_t kMaxContentLength = 64 * 1024 * 1024;
+
+    enum class HeaderState
+    {
+        LineStart, // start of a header line, or the blank line ending the block
+        Name,      // inside a field name
+        Value,     // after the ':'
+        LineEnd,   // seen CR, expecting LF
+        BlockEnd,  // seen CR of the blank line, expecting LF
+        Done,
+        Invalid
+    };
+
+    enum class HeaderField
+    {
+        Other,
+        ContentLength,
+        ContentType
+    };
+
+    // Byte-level header parser
+    // Offsets are relative to the start of the frame (buf.head), so the scan position
+    // survives more bytes being read, and the arena relocating the unread bytes
+    struct HeaderParser
+    {
+        HeaderState state = HeaderState::LineStart;
+        HeaderField field = HeaderField::Other;
+        size_t scan = 0;
+        size_t name_start = 0;
+        size_t value_start = 0;
+        size_t value_end = 0;
+
+        bool has_length = false;
+        bool length_digits = false;
+        bool length_done = false; // trailing whitespace seen after the digits
+        size_t content_length = 0;
+    };
+
+    char to_lower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+    }
+
+    // ASCII case-insensitive compare against a lowercase literal
+    bool equals_lower(std::string_view s, std::string_view lower)
+    {
+        if (s.size() != lower.size())
+            return false;
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            if (to_lower(s[i]) != lower[i])
+                return false;
+        }
+        return true;
     }
-    return map;
+
+    // Field names are RFC 7230 tokens
+    bool is_token_char(char c)
+    {
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+            return true;
+        return c != '\0' && std::strchr("!#$%&'*+-.^_`|~", c) != nullptr;
+    }
+
+    // Content-Type is optional, but if a charset is given it has to be utf-8 ("utf8" is accepted for old clients)
+    bool valid_content_type(std::string_view value)
+    {
+        static constexpr std::string_view kCharset = "charset=";
+        for (size_t i = 0; i + kCharset.size() <= value.size(); ++i)
+        {
+            if (!equals_lower(value.substr(i, kCharset.size()), kCharset))
+                continue;
+
+            std::string_view charset = value.substr(i + kCharset.size());
+            size_t stop = charset.find(';');
+            if (stop != std::string_view::npos)
+                charset = charset.substr(0, stop);
+            while (!charset.empty() && (charset.back() == ' ' || charset.back() == '\t'))
+                charset.remove_suffix(1);
+            if (charset.size() >= 2 && charset.front() == '"' && charset.back() == '"')
+                charset = charset.substr(1, charset.size() - 2);
+
+            return equals_lower(charset, "utf-8") || equals_lower(charset, "utf8");
+        }
+        return true;
+    }
+
+    // Handles one byte of the current field value
+    bool feed_value(HeaderParser &p, char c, size_t offset)
+    {
+        bool ws = c == ' ' || c == '\t';
+
+        if (p.field == HeaderField::ContentLength)
+        {
+            if (ws)
+            {
+                // Leading or trailing whitespace only
+                p.length_done = p.length_digits;
+                return true;
+            }
+            if (c < '0' || c > '9' || p.length_done)
+                return false;
+
+            p.content_length = p.content_length * 10 + static_cast<size_t>(c - '0');
+            p.length_digits = true;
+            return p.content_length <= kMaxContentLength;
+        }
+
+        if (static_cast<unsigned char>(c) < 0x20 && c != '\t')
+            return false;
+
+        // Track the trimmed value so it can be checked in place once the line ends
+        if (!ws)
+        {
+            if (p.value_start == p.value_end)
+                p.value_start = offset;
+            p.value_end = offset + 1;
+        }
+        return true;
+    }
+
+    // Called once CRLF ends a field line
+    bool finish_line(HeaderParser &p, std::string_view frame)
+    {
+        if (p.field == HeaderField::ContentLength)
+            return p.length_digits;
+
+        if (p.field == HeaderField::ContentType)
+            return valid_content_type(frame.substr(p.value_start, p.value_end - p.value_start));
+
+        return true;
+    }
+
+    // Advances the parser over the bytes read so far
+    // Returns once the blank line has been reached, the header is rejected, or the bytes run out
+    void parse_headers(HeaderParser &p, std::string_view frame)
+    {
+        size_t limit = frame.size() < kMaxHeaderBytes ? frame.size() : kMaxHeaderBytes;
+
+        while (p.scan < limit && p.state != HeaderState::Done && p.state != HeaderState::Invalid)
+        {
+            char c = frame[p.scan];
+            switch (p.state)
+            {
+            case HeaderState::LineStart:
+                if (c == '\r')
+                {
+                    p.state = HeaderState::BlockEnd;
+                    break;
+                }
+                if (!is_token_char(c))
+                {
+                    p.state = HeaderState::Invalid;
+                    break;
+                }
+                p.name_start = p.scan;
+                p.state = HeaderState::Name;
+                break;
+
+            case HeaderState::Name:
+                if (c == ':')
+                {
+                    std::string_view name = frame.substr(p.name_start, p.scan - p.name_start);
+                    p.field = HeaderField::Other;
+                    if (equals_lower(name, "content-length"))
+                    {
+                        // A second Content-Length makes the frame ambiguous
+                        if (p.has_length)
+                        {
+                            p.state = HeaderState::Invalid;
+                            break;
+                        }
+                        p.field = HeaderField::ContentLength;
+                        p.has_length = true;
+                    }
+                    else if (equals_lower(name, "content-type"))
+                    {
+                        p.field = HeaderField::ContentType;
+                    }
+                    p.value_start = p.value_end = 0;
+                    p.state = HeaderState::Value;
+                    break;
+                }
+                if (!is_token_char(c) || p.scan - p.name_start >= kMaxFieldNameBytes)
+                    p.state = HeaderState::Invalid;
+                break;
+
+            case HeaderState::Value:
+                if (c == '\r')
+                {
+                    p.state = HeaderState::LineEnd;
+                    break;
+                }
+                if (!feed_value(p, c, p.scan))
+                    p.state = HeaderState::Invalid;
+                break;
+
+            case HeaderState::LineEnd:
+                if (c != '\n' || !finish_line(p, frame))
+                {
+                    p.state = HeaderState::Invalid;
+                    break;
+                }
+                p.state = HeaderState::LineStart;
+                break;
+
+            case HeaderState::BlockEnd:
+                p.state = (c == '\n' && p.has_length) ? HeaderState::Done : HeaderState::Invalid;
+                break;
+
+            default:
+                break;
+            }
+            ++p.scan;
+        }
+
+        // Ran past the size limit without finding the blank line
+        if (p.state != HeaderState::Done && p.scan >= kMaxHeaderBytes)
+            p.state = HeaderState::Invalid;
+    }
+
+    // Header state of the frame starting at head, kept across calls so every header byte is parsed once
+    // Its offsets are relative to head, which only moves once the frame is consumed (and it is reset then)
+    HeaderParser next_headers;
+}
+
+bool lsp_message_buffered()
+{
+    // Advances the same parser read_lsp_message carries on with, so no header byte is looked at twice
+    const FrameBuffer &buf = frame;
+    std::string_view pending(buf.data.get() + buf.head, buf.tail - buf.head);
+
+    parse_headers(next_headers, pending);
+    return next_headers.state == HeaderState::Done && pending.size() - next_headers.scan >= next_headers.content_length;
 }
 
 // Reads one LSP message body into out_json. Returns false on EOF/stream error.
-bool read_lsp_message(std::istream &in, std::string &out_json)
+bool read_lsp_message(Transport &in, std::string_view &out_json)
 {
-    static std::string buffer;
-    char chunk[4096];
+    FrameBuffer &buf = frame;
+
+    // The previous body is released once we are called again, so an empty arena can be rewound for free
+    if (buf.head == buf.tail)
+        buf.head = buf.tail = 0;
 
-    std::size_t sep = std::string::npos;
+    // Picks up wherever lsp_message_buffered (or nothing) left the parser
+    HeaderParser &headers = next_headers;
 
     // Read header block
     while (true)
     {
-        // Read more data if needed
-        if (in.good())
-        {
-            in.read(chunk, sizeof(chunk));
-            buffer.append(chunk, static_cast<size_t>(in.gcount()));
-        }
-        if (buffer.empty() && in.eof())
+        // Only the bytes that arrived since the last pass are looked at
+        parse_headers(headers, std::string_view(buf.data.get() + buf.head, buf.tail - buf.head));
+
+        // Oversized or malformed headers, the stream can't be trusted from here
+        if (headers.state == HeaderState::Invalid)
             return false;
 
-        // Find header/content separator
-        sep = buffer.find("\r\n\r\n");
-        // Keep reading until header + sep is in the buffer
-        if (sep == std::string::npos)
-            continue;
+        // If the blank line has been reached (headers are all in the buffer)...
+        if (headers.state == HeaderState::Done)
+            break;
 
-        // If the sep is in the buffer (headers are all in the buffer)...
-        break;
+        // Keep reading until header + sep is in the buffer
+        if (!fill(in, buf, 1))
+            return false;
     }
 
-    // Slice headers, making sure to include final CRLF
-    std::string header_block = buffer.substr(0, sep + 2);
-    std::unordered_map<std::string, std::string> headers = parse_headers(header_block);
-
-    // Find required length header
-    std::unordered_map<std::string, std::string>::iterator it = headers.find("Content-Length");
-    if (it == headers.end())
-        return false;
-
     // Body begins after CRLFCRLF, and is "content_len" bytes long
-    size_t content_len = static_cast<size_t>(std::stoul(it->second));
-    size_t body_start = sep + 4;
-
-    if (content_len > out_json.max_size())
-        return false;
+    // Offsets are kept relative to head, as reading more may relocate the unread bytes
+    size_t content_len = headers.content_length;
+    size_t body_start = headers.scan;
 
     // Read body block
-    while (buffer.size() < body_start + content_len)
+    while (buf.tail - buf.head < body_start + content_len)
     {
-        // Read more data if needed
-        if (in.good())
-        {
-            in.read(chunk, sizeof(chunk));
-            buffer.append(chunk, static_cast<size_t>(in.gcount()));
-        }
-        if (buffer.size() < body_start + content_len && in.eof())
+        if (!fill(in, buf, body_start + content_len - (buf.tail - buf.head)))
             // Content was greater than the content_length header
             return false;
     }
 
-    // Extract JSON body by length
-    out_json = buffer.substr(body_start, content_len);
+    // Hand out the JSON body in place
+    out_json = std::string_view(buf.data.get() + buf.head + body_start, content_len);
 
-    // Remove consumed data from buffer (if multiple messages are queued via batch message)
-    buffer.erase(0, body_start + content_len);
+    // Mark consumed data (if multiple messages are queued, the rest stay where they are)
+    buf.head += body_start + content_len;
+    headers = HeaderParser{};
     return true;
 
     // the headers do not need to be memorised from here, so it should be safe to call
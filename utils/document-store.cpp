@@ -0,0 +1,134 @@
+#include "headers/document-store.h"
+
+#include <cstring>
+
+namespace
+{
+    // Length in bytes, and in UTF-16 code units, of the UTF-8 sequence starting with lead
+    // Invalid bytes count as one unit each, so a broken document still maps somewhere sensible
+    void utf8_sequence(unsigned char lead, size_t &bytes, uint32_t &units)
+    {
+        units = 1;
+        if (lead < 0x80)
+            bytes = 1;
+        else if ((lead & 0xE0) == 0xC0)
+            bytes = 2;
+        else if ((lead & 0xF0) == 0xE0)
+            bytes = 3;
+        else if ((lead & 0xF8) == 0xF0)
+        {
+            bytes = 4;
+            units = 2; // outside the BMP, a surrogate pair
+        }
+        else
+            bytes = 1;
+    }
+}
+
+size_t positionToOffset(std::string_view text, const Position &position)
+{
+    // Start of the line
+    size_t line_start = 0;
+    for (uint32_t line = 0; line < position.line; ++line)
+    {
+        const void *newline = std::memchr(text.data() + line_start, '\n', text.size() - line_start);
+        if (newline == nullptr)
+            return text.size();
+        line_start = static_cast<size_t>(static_cast<const char *>(newline) - text.data()) + 1;
+    }
+
+    // End of its content, the \n or \r\n isn't part of the line
+    size_t line_end = text.size();
+    if (const void *newline = std::memchr(text.data() + line_start, '\n', text.size() - line_start))
+        line_end = static_cast<size_t>(static_cast<const char *>(newline) - text.data());
+    if (line_end > line_start && text[line_end - 1] == '\r')
+        --line_end;
+
+    // Walk the code points, counting UTF-16 units
+    size_t offset = line_start;
+    uint32_t units = 0;
+    while (offset < line_end && units < position.character)
+    {
+        size_t bytes = 0;
+        uint32_t width = 0;
+        utf8_sequence(static_cast<unsigned char>(text[offset]), bytes, width);
+
+        // A position in the middle of a surrogate pair can't be honoured, it stays before the character
+        if (units + width > position.character || offset + bytes > line_end)
+            break;
+
+        offset += bytes;
+        units += width;
+    }
+    return offset;
+}
+
+void DocumentStore::open(const TextDocumentItem &item)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Document &document = documents[item.uri];
+    document.languageId = item.languageId;
+    document.version = item.version;
+    document.text = item.text;
+}
+
+bool DocumentStore::change(const VersionedTextDocumentIdentifier &identifier,
+                           const std::vector<TextDocumentContentChangeEvent> &changes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = documents.find(identifier.uri);
+    if (found == documents.end())
+        return false;
+
+    Document &document = found->second;
+    for (const TextDocumentContentChangeEvent &change : changes)
+    {
+        // No range means the whole document was sent
+        if (!change.range.has_value())
+        {
+            document.text = change.text;
+            continue;
+        }
+
+        // Each change's positions are against the text as left by the one before it
+        size_t start = positionToOffset(document.text, change.range->start);
+        size_t end = positionToOffset(document.text, change.range->end);
+        if (end < start)
+            end = start;
+        document.text.replace(start, end - start, change.text);
+    }
+
+    document.version = identifier.version;
+    return true;
+}
+
+void DocumentStore::close(const std::string &uri)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    documents.erase(uri);
+}
+
+bool DocumentStore::snapshot(const std::string &uri, DocumentSnapshot &out) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = documents.find(uri);
+    if (found == documents.end())
+        return false;
+
+    out.uri = uri;
+    out.languageId = found->second.languageId;
+    out.version = found->second.version;
+    out.text = found->second.text;
+    return true;
+}
+
+bool DocumentStore::version(const std::string &uri, int32_t &out) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = documents.find(uri);
+    if (found == documents.end())
+        return false;
+
+    out = found->second.version;
+    return true;
+}
@@ -1,15 +1,30 @@
 #pragma once
+#include <memory>
 #include <string>
 #include <optional>
+#include <string_view>
+
+#include "JSON-tape.h"
+#include "lsp-methods.h"
+#include "request-id.h"
 
 struct Message
 {
-    float jsonrpc; // Required in all incoming messages, validation handled via storeMessage()
-    std::optional<int> id = std::nullopt;
+    // No jsonrpc member: storeMessage() only accepts "2.0", and the encoder always writes it
+    std::optional<RequestId> id = std::nullopt; // int | string
     std::optional<std::string> method = std::nullopt;
-    std::optional<std::string> params_json = std::nullopt;
+    LspMethod method_id = LspMethod::Unknown; // resolved from method by storeMessage
+    // Views the body it was decoded from (valid until the next read_lsp_message), see keepParams
+    std::optional<std::string_view> params_json = std::nullopt;
+    std::shared_ptr<const std::string> params_storage; // set by keepParams
     std::optional<std::string> result = std::nullopt;
     std::optional<std::string> error = std::nullopt;
 };
 
-bool storeMessage(const std::string &json, Message &out);
+// Decodes a JSON-RPC body into out
+// The tape overload keeps the index of the body, so params can be read from it without reparsing
+bool storeMessage(std::string_view json, Message &out, JsonTape &tape);
+bool storeMessage(std::string_view json, Message &out);
+
+// Copies params out of the body, for a message that has to outlive it (a request moved onto a worker)
+void keepParams(Message &msg);
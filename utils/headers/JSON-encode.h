@@ -1,5 +1,23 @@
 #pragma once
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include "JSON-decode.h"
 
+// Big enough for the Content-Length + Content-Type header block
+constexpr size_t kLspHeaderCapacity = 128;
+
+// Writes value as a quoted, escaped JSON string onto out
+void appendEscapedJsonString(std::string_view value, std::string &out);
+
+// Writes id as a JSON number or string onto out
+void appendRequestId(const RequestId &id, std::string &out);
+
+// Encodes msg as a JSON-RPC body (no headers) into out_json, reusing its capacity
+bool serialiseMessage(const Message &msg, std::string &out_json);
+
+// Writes the header block for a body of body_size bytes into out, returns its length (0 if it doesn't fit)
+size_t writeLspHeader(size_t body_size, char *out, size_t capacity);
+
+// Encodes msg as a complete LSP packet (headers + body)
 bool serialiseLspPacket(const Message &msg, std::string &out_packet);
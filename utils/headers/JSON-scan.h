@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Low level JSON lexing shared by the decoders
+// Every function takes the cursor `i` by reference and only moves it forward on success
+namespace json_scan
+{
+    // Nesting deeper than this is rejected rather than recursed into
+    constexpr size_t kMaxDepth = 256;
+
+    // Moves cursor past whitespace
+    void skip_ws(std::string_view s, size_t &i);
+
+    // Offset of the first '"', '\\' or control character (< 0x20) at or after i, or s.size() if there isn't one
+    // Vectorised (AVX2 / SSE2, picked at runtime), so long clean runs cost a compare per 16-32 bytes
+    size_t find_special(std::string_view s, size_t i);
+
+    // Moves cursor past a string (cursor on the opening quote), validating escapes and control characters
+    // `escaped` is set if the contents need decode_string, otherwise they can be used as-is
+    bool scan_string(std::string_view s, size_t &i, bool &escaped);
+
+    // Decodes the contents of an already scanned string (the bytes between the quotes)
+    // \u escapes (including UTF-16 surrogate pairs) come out as UTF-8
+    bool decode_string(std::string_view raw, std::string &out);
+
+    // Same, into a caller buffer of at least raw.size() bytes (decoding never grows the text)
+    bool decode_string(std::string_view raw, char *out, size_t &out_size);
+
+    // Matches "true", "false" or "null"
+    bool parse_literal(std::string_view s, size_t &i, std::string_view literal);
+
+    // Moves cursor past a number
+    // -? (0|[1-9][0-9]*) (.[0-9]+)? ([eE][+-]?[0-9]+)?
+    bool scan_number(std::string_view s, size_t &i);
+
+    // Number values, parsed in place from a whole token (from_chars, no copies or terminators needed)
+    // to_integer also takes fractions/exponents ("1e3", "2.0") as long as the value is a whole number that fits
+    bool to_double(std::string_view token, double &out);
+    bool to_integer(std::string_view token, long long &out);
+
+    // Moves cursor past any value (and the whitespace in front of it)
+    bool skip_value(std::string_view s, size_t &i);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class TapeType : uint8_t
+{
+    Null,
+    True,
+    False,
+    Number,
+    String,
+    Object,
+    Array
+};
+
+// One node per JSON value, in document order
+// Object members are stored as a String node (the key) directly followed by the value's node(s)
+struct TapeNode
+{
+    TapeType type = TapeType::Null;
+
+    // Strings only: the contents contain escapes, and have to go through json_scan::decode_string
+    bool escaped = false;
+
+    // Byte span in the source
+    // Strings: the contents between the quotes, containers: the whole value including brackets
+    uint32_t begin = 0;
+    uint32_t end = 0;
+
+    // Index of the first node after this value (and all of its children)
+    uint32_t next = 0;
+
+    // Containers only: number of members / elements
+    uint32_t count = 0;
+};
+
+// Index over a JSON document, built in a single pass
+// Holds views into `source`, so it is only valid while the source bytes are
+struct JsonTape
+{
+    std::string_view source;
+    std::vector<TapeNode> nodes;
+};
+
+constexpr size_t kNoTapeNode = static_cast<size_t>(-1);
+
+// Tokenises json into out (reusing its storage). Root is node 0
+bool buildTape(std::string_view json, JsonTape &out);
+
+// Value node of `key` in the object at `object`, or kNoTapeNode
+size_t tapeFindMember(const JsonTape &tape, size_t object, std::string_view key);
+
+// Source bytes of a node (see TapeNode::begin/end)
+std::string_view tapeRaw(const JsonTape &tape, size_t node);
+
+// Decoded contents of a String node
+bool tapeString(const JsonTape &tape, size_t node, std::string &out);
+
+// Value of a Number node
+bool tapeNumber(const JsonTape &tape, size_t node, double &out);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Streaming JSON output, written straight into a caller owned buffer
+// Commas and colons are placed by the writer, and strings are always escaped, so as long as
+// every begin_* is matched by its end_* (and keys are only written inside objects) the output
+// is valid by construction and never has to be re-scanned before it is sent
+class JsonWriter
+{
+public:
+    JsonWriter() = default;
+    explicit JsonWriter(std::string &out) { reset(out); }
+
+    // Points the writer at out (appending to whatever is already there)
+    void reset(std::string &out);
+
+    void begin_object();
+    void end_object();
+    void begin_array();
+    void end_array();
+
+    // Writes "name": -- the next call writes its value
+    void key(std::string_view name);
+
+    // Values
+    void string(std::string_view value);
+    void value(bool value);
+    void value(double value);
+    void value(const char *) = delete; // would silently become a bool, use string()
+    template <typename T>
+    std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>> value(T value)
+    {
+        if constexpr (std::is_signed_v<T>)
+            write_integer(static_cast<long long>(value));
+        else
+            write_unsigned(static_cast<unsigned long long>(value));
+    }
+    void null();
+
+    // Writes an already encoded JSON value as-is, it is trusted and not validated
+    void raw(std::string_view json);
+
+    // True if a key has been written and its value hasn't
+    bool awaiting_value() const { return after_key; }
+
+    std::string &buffer() { return *out; }
+
+private:
+    std::string *out = nullptr;
+    std::vector<bool> has_member; // one entry per open object/array
+    bool after_key = false;
+
+    void separate();
+    void write_integer(long long value);
+    void write_unsigned(unsigned long long value);
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "JSON-writer.h"
+#include "document-store.h"
+#include "in-flight-table.h"
+#include "request-executor.h"
+#include "response-sequencer.h"
+
+// Writes a document's diagnostics, as the elements of the JSON array diagnostics is positioned in
+// superseded is set once the document has been edited again, the analyser should check it between steps
+// and return false once it is (or on any other failure), nothing is published then
+using Analyser = std::function<bool(const DocumentSnapshot &document, const CancellationToken &superseded,
+                                    JsonWriter &diagnostics)>;
+
+// How long edits are gathered before a document is analysed
+struct DebounceWindows
+{
+    std::chrono::milliseconds quiet{200};      // analyse once no edit has arrived for this long
+    std::chrono::milliseconds max_delay{1000}; // but never later than this after the first edit it covers
+};
+
+// Coalesces didOpen / didChange into as few analyses as possible (textDocument/publishDiagnostics)
+// Edits are already in the DocumentStore by the time changed() is called, this only decides when to look at them:
+// - a burst of edits to a document is one analysis, run once typing pauses for `quiet`,
+//   or after `max_delay` if it never does, so a long burst still gets feedback
+// - the analysis runs on the executor's Background lane, against a snapshot of the newest text
+// - an edit arriving while an analysis runs marks it superseded, and it is dropped rather than published,
+//   so only the newest version is ever published
+// A timer thread of its own waits out the windows, the main thread never blocks on them
+class AnalysisPipeline
+{
+public:
+    AnalysisPipeline(DocumentStore &documents, RequestExecutor &executor, ResponseSequencer &responses,
+                     Analyser analyser, DebounceWindows windows = {});
+    ~AnalysisPipeline();
+
+    AnalysisPipeline(const AnalysisPipeline &) = delete;
+    AnalysisPipeline &operator=(const AnalysisPipeline &) = delete;
+
+    // The document was opened or edited
+    void changed(const std::string &uri);
+
+    // The document was closed, anything pending or running for it is dropped
+    void closed(const std::string &uri);
+
+    // No more analyses are scheduled or published (shutdown). Analyses already on the executor drop out
+    void stop();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        bool pending = false;
+        Clock::time_point first_edit; // oldest edit not analysed yet
+        Clock::time_point last_edit;
+        std::shared_ptr<std::atomic<bool>> running; // superseded flag of the analysis in flight, if any
+    };
+
+    DocumentStore &documents;
+    RequestExecutor &executor;
+    ResponseSequencer &responses;
+    Analyser analyser;
+    DebounceWindows windows;
+
+    std::mutex mutex;
+    std::condition_variable wake; // an edit arrived, or the pipeline is stopping
+    std::unordered_map<std::string, Entry> entries;
+    bool stopping = false;
+    std::thread timer;
+
+    void timer_loop();
+    void analyse(const std::string &uri, const std::shared_ptr<std::atomic<bool>> &superseded);
+};
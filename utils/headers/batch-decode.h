@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "JSON-decode.h"
+#include "JSON-tape.h"
+#include "request-executor.h"
+
+// JSON-RPC batches: a top-level array of messages, sent as one packet
+// The array is split into its elements in one scan, the elements are decoded concurrently,
+// and the messages are then dispatched in order by the caller
+
+// Everything decodeBatch produces, kept between batches so the tapes and strings are reused
+struct BatchDecoder
+{
+    std::vector<std::string_view> elements; // raw text of each element
+    std::vector<JsonTape> tapes;
+    std::vector<Message> messages;
+    std::vector<uint8_t> valid; // per element, false if it isn't a valid message
+    bool malformed = false;     // decodeBatch failed because the body isn't a well formed array (rather than an empty one)
+};
+
+// True if the body is a batch rather than a single message
+bool isBatch(std::string_view json);
+
+// Raw text of each element of a top-level array (the array itself is validated, the elements are not)
+bool splitBatch(std::string_view json, std::vector<std::string_view> &out_elements);
+
+// Splits and decodes a batch, invalid elements are flagged in out.valid
+// Returns false if json isn't a well formed, non-empty array (see out.malformed)
+// Big batches are decoded on executor's workers
+bool decodeBatch(std::string_view json, BatchDecoder &out, RequestExecutor &executor);
@@ -1,5 +1,12 @@
 #pragma once
-#include <istream>
 #include <string>
+#include <string_view>
 
-bool read_lsp_message(std::istream &in, std::string &out_json);
+#include "transport.h"
+
+// Reads one LSP message body into out_json. Returns false on EOF/stream error.
+// out_json is a view into the reader's frame buffer, and stays valid until the next call.
+bool read_lsp_message(Transport &in, std::string_view &out_json);
+
+// True if a complete message is already buffered, i.e. the next read_lsp_message won't block
+bool lsp_message_buffered();
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "lsp-types.h"
+
+// A copy of one document at one version, for work that runs away from the main thread
+struct DocumentSnapshot
+{
+    std::string uri;
+    std::string languageId;
+    int32_t version = 0;
+    std::string text;
+};
+
+// Open documents, kept in sync by didOpen / didChange / didClose (see notes/Document-Sync.md)
+// Edits are applied in place as they arrive, on the main thread. Anything else reads through
+// snapshot(), which copies the text under the store's lock, so a copy is only made when
+// something actually needs the document rather than once per keystroke
+class DocumentStore
+{
+public:
+    void open(const TextDocumentItem &item);
+
+    // Applies the changes in order, then takes the new version
+    // Returns false if the document isn't open (the changes are dropped)
+    bool change(const VersionedTextDocumentIdentifier &document, const std::vector<TextDocumentContentChangeEvent> &changes);
+
+    void close(const std::string &uri);
+
+    bool snapshot(const std::string &uri, DocumentSnapshot &out) const;
+
+    // Current version, false if the document isn't open
+    bool version(const std::string &uri, int32_t &out) const;
+
+private:
+    struct Document
+    {
+        std::string languageId;
+        int32_t version = 0;
+        std::string text;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Document> documents;
+};
+
+// Byte offset of a UTF-16 position (the default position encoding) in UTF-8 text
+// Out of range positions are clamped the way the spec asks: a character past the end of its line
+// means the end of the line (before its line break), a line past the last one means the end of the text
+size_t positionToOffset(std::string_view text, const Position &position);
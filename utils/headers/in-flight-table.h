@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "request-id.h"
+
+// What a handler polls, at its own checkpoints, to find out its request was cancelled ($/cancelRequest)
+// One relaxed load, cheap enough to check inside loops. A default constructed token is never cancelled
+class CancellationToken
+{
+public:
+    CancellationToken() = default;
+    explicit CancellationToken(const std::atomic<bool> *flag) : flag(flag) {}
+
+    bool cancelled() const { return flag != nullptr && flag->load(std::memory_order_relaxed); }
+
+private:
+    const std::atomic<bool> *flag = nullptr;
+};
+
+// Requests queued or running on a worker, keyed by id, so $/cancelRequest can reach them
+// Fixed size and open addressed: an id only ever sits in the kProbe slots starting at its hash, so entries
+// never move, a lookup looks at kProbe slots at most, and nothing allocates (bar ids too long to keep inline)
+// insert() and cancel() are called by the main thread, release() by whichever worker answered the request,
+// and a slot changes hands through its atomic `used` flag, there is no lock
+class InFlightTable
+{
+public:
+    static constexpr size_t kCapacity = 256; // power of two
+    static constexpr size_t kProbe = 16;
+    static constexpr size_t kNoSlot = SIZE_MAX;
+
+    InFlightTable() = default;
+    InFlightTable(const InFlightTable &) = delete;
+    InFlightTable &operator=(const InFlightTable &) = delete;
+
+    // Returns the request's slot, or kNoSlot if every slot it could use is taken
+    // (the request still runs, it just can't be cancelled)
+    size_t insert(const RequestId &id);
+
+    // Flags id's token, returns false if it isn't in flight (already answered, or never was)
+    bool cancel(const RequestId &id);
+
+    // Once the request has been answered
+    void release(size_t slot);
+
+    // kNoSlot gets a token that is never cancelled
+    CancellationToken token(size_t slot) const;
+
+private:
+    struct Slot
+    {
+        std::atomic<bool> used{false};
+        std::atomic<bool> cancelled{false};
+        // Only read and written by the main thread
+        uint64_t hash = 0;
+        RequestId id;
+    };
+
+    Slot slots[kCapacity];
+};
@@ -1,6 +1,13 @@
 #pragma once
 
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 enum class LogEventType
 {
@@ -13,13 +20,105 @@ enum class LogEventType
 
 enum class LogSeverity
 {
-    Info,
-    Warning,
-    Error
+    Info = 0,
+    Warning = 1,
+    Error = 2
 };
 
-bool initialiseLogger(const std::string &directory, std::string &out_logfile);
+// Events below this are compiled out of LSP_LOG entirely (0 Info, 1 Warning, 2 Error)
+#ifndef LSP_LOG_MIN_SEVERITY
+#define LSP_LOG_MIN_SEVERITY 0
+#endif
+
+// Log size cap: at most segment_count segments of segment_bytes each are kept on disk
+struct LogRotation
+{
+    size_t segment_bytes = 8 * 1024 * 1024;
+    size_t segment_count = 4;
+};
+
+// Creates the first log segment and starts the background writer, out_logfile is "" if logging is unavailable
+bool initialiseLogger(const std::string &directory, std::string &out_logfile, const LogRotation &rotation = LogRotation{});
+
+// Queues an event for the background writer, it reaches the file within ~100ms (sooner for errors)
+// Returns false if logging is off (logfile == ""), or the queue was full and the event was dropped
 bool logEvent(const std::string &logfile,
               const std::string &event_description,
               LogEventType event_type,
               LogSeverity severity);
+
+// Writes out everything still queued and closes the logfile
+void shutdownLogger();
+
+// Runtime threshold for LSP_LOG, events below it are skipped before anything is formatted
+// Until initialiseLogger succeeds everything is skipped
+void setLogThreshold(LogSeverity severity);
+
+// Queues an already formatted event (logEvent without the logfile check)
+bool logMessage(std::string_view event_description, LogEventType event_type, LogSeverity severity);
+
+namespace log_detail
+{
+    // Lowest severity that gets written, 3 (above Error) while logging is off
+    extern std::atomic<int> threshold;
+
+    inline bool enabled(LogSeverity severity)
+    {
+        return static_cast<int>(severity) >= threshold.load(std::memory_order_relaxed);
+    }
+
+    // One buffer per thread, so formatting an event never allocates once it has warmed up
+    std::string &format_buffer();
+}
+
+// Formatting for LSP_LOG arguments, add an overload (next to the type) to log anything else
+inline void appendLogArg(std::string &out, std::string_view value) { out.append(value.data(), value.size()); }
+inline void appendLogArg(std::string &out, const char *value) { out.append(value); }
+inline void appendLogArg(std::string &out, const std::string &value) { out.append(value); }
+inline void appendLogArg(std::string &out, char value) { out.push_back(value); }
+inline void appendLogArg(std::string &out, bool value) { out.append(value ? "true" : "false"); }
+inline void appendLogArg(std::string &out, double value)
+{
+    char digits[32];
+    int written = std::snprintf(digits, sizeof(digits), "%g", value);
+    if (written > 0)
+        out.append(digits, static_cast<size_t>(written));
+}
+template <typename T>
+std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>>
+appendLogArg(std::string &out, T value)
+{
+    char digits[24];
+    std::to_chars_result r = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, r.ptr);
+}
+template <typename T>
+void appendLogArg(std::string &out, const std::optional<T> &value)
+{
+    if (value.has_value())
+        appendLogArg(out, *value);
+    else
+        out.append("<none>");
+}
+
+// Formats the arguments back to back into the thread's buffer, and queues the event
+template <typename... Args>
+bool logFormatted(LogEventType event_type, LogSeverity severity, const Args &...args)
+{
+    std::string &out = log_detail::format_buffer();
+    out.clear();
+    (appendLogArg(out, args), ...);
+    return logMessage(out, event_type, severity);
+}
+
+// LSP_LOG(LogSeverity::Info, LogEventType::Request, "Decoded ", method, " id=", id);
+// Arguments are only evaluated (and formatted) when the event is actually going to be written
+#define LSP_LOG(severity, event_type, ...)                                                  \
+    do                                                                                      \
+    {                                                                                       \
+        if constexpr (static_cast<int>(severity) >= LSP_LOG_MIN_SEVERITY)                   \
+        {                                                                                   \
+            if (log_detail::enabled(severity))                                              \
+                logFormatted(event_type, severity, __VA_ARGS__);                            \
+        }                                                                                   \
+    } while (0)
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Every LSP 3.17 method (see notes/*.md), as X(enum name, method string, direction)
+// Direction is who sends it: Client (client -> server), Server (server -> client) or Both
+#define LSP_METHOD_LIST(X)                                                              \
+    /* Lifecycle */                                                                     \
+    X(Initialize, "initialize", Client)                                                 \
+    X(Initialized, "initialized", Client)                                               \
+    X(Shutdown, "shutdown", Client)                                                     \
+    X(Exit, "exit", Client)                                                             \
+    X(RegisterCapability, "client/registerCapability", Server)                          \
+    X(UnregisterCapability, "client/unregisterCapability", Server)                      \
+    X(SetTrace, "$/setTrace", Client)                                                   \
+    X(LogTrace, "$/logTrace", Server)                                                   \
+    X(CancelRequest, "$/cancelRequest", Both)                                           \
+    X(Progress, "$/progress", Both)                                                     \
+    /* Document sync */                                                                 \
+    X(DidOpen, "textDocument/didOpen", Client)                                          \
+    X(DidChange, "textDocument/didChange", Client)                                      \
+    X(WillSave, "textDocument/willSave", Client)                                        \
+    X(WillSaveWaitUntil, "textDocument/willSaveWaitUntil", Client)                      \
+    X(DidSave, "textDocument/didSave", Client)                                          \
+    X(DidClose, "textDocument/didClose", Client)                                        \
+    X(NotebookDidOpen, "notebookDocument/didOpen", Client)                              \
+    X(NotebookDidChange, "notebookDocument/didChange", Client)                          \
+    X(NotebookDidSave, "notebookDocument/didSave", Client)                              \
+    X(NotebookDidClose, "notebookDocument/didClose", Client)                            \
+    /* Language features */                                                             \
+    X(Declaration, "textDocument/declaration", Client)                                  \
+    X(Definition, "textDocument/definition", Client)                                    \
+    X(TypeDefinition, "textDocument/typeDefinition", Client)                            \
+    X(Implementation, "textDocument/implementation", Client)                            \
+    X(References, "textDocument/references", Client)                                   \
+    X(PrepareCallHierarchy, "textDocument/prepareCallHierarchy", Client)                \
+    X(CallHierarchyIncomingCalls, "callHierarchy/incomingCalls", Client)                \
+    X(CallHierarchyOutgoingCalls, "callHierarchy/outgoingCalls", Client)                \
+    X(PrepareTypeHierarchy, "textDocument/prepareTypeHierarchy", Client)                \
+    X(TypeHierarchySupertypes, "typeHierarchy/supertypes", Client)                      \
+    X(TypeHierarchySubtypes, "typeHierarchy/subtypes", Client)                          \
+    X(DocumentHighlight, "textDocument/documentHighlight", Client)                      \
+    X(DocumentLink, "textDocument/documentLink", Client)                                \
+    X(DocumentLinkResolve, "documentLink/resolve", Client)                              \
+    X(Hover, "textDocument/hover", Client)                                              \
+    X(CodeLens, "textDocument/codeLens", Client)                                        \
+    X(CodeLensResolve, "codeLens/resolve", Client)                                      \
+    X(CodeLensRefresh, "workspace/codeLens/refresh", Server)                            \
+    X(FoldingRange, "textDocument/foldingRange", Client)                                \
+    X(SelectionRange, "textDocument/selectionRange", Client)                            \
+    X(DocumentSymbol, "textDocument/documentSymbol", Client)                            \
+    X(SemanticTokensFull, "textDocument/semanticTokens/full", Client)                   \
+    X(SemanticTokensFullDelta, "textDocument/semanticTokens/full/delta", Client)        \
+    X(SemanticTokensRange, "textDocument/semanticTokens/range", Client)                 \
+    X(SemanticTokensRefresh, "workspace/semanticTokens/refresh", Server)                \
+    X(InlayHint, "textDocument/inlayHint", Client)                                      \
+    X(InlayHintResolve, "inlayHint/resolve", Client)                                    \
+    X(InlayHintRefresh, "workspace/inlayHint/refresh", Server)                          \
+    X(InlineValue, "textDocument/inlineValue", Client)                                  \
+    X(InlineValueRefresh, "workspace/inlineValue/refresh", Server)                      \
+    X(Moniker, "textDocument/moniker", Client)                                          \
+    X(Completion, "textDocument/completion", Client)                                    \
+    X(CompletionItemResolve, "completionItem/resolve", Client)                          \
+    X(PublishDiagnostics, "textDocument/publishDiagnostics", Server)                    \
+    X(DocumentDiagnostic, "textDocument/diagnostic", Client)                            \
+    X(WorkspaceDiagnostic, "workspace/diagnostic", Client)                              \
+    X(DiagnosticRefresh, "workspace/diagnostic/refresh", Server)                        \
+    X(SignatureHelp, "textDocument/signatureHelp", Client)                              \
+    X(CodeAction, "textDocument/codeAction", Client)                                    \
+    X(CodeActionResolve, "codeAction/resolve", Client)                                  \
+    X(DocumentColor, "textDocument/documentColor", Client)                              \
+    X(ColorPresentation, "textDocument/colorPresentation", Client)                      \
+    X(Formatting, "textDocument/formatting", Client)                                    \
+    X(RangeFormatting, "textDocument/rangeFormatting", Client)                          \
+    X(OnTypeFormatting, "textDocument/onTypeFormatting", Client)                        \
+    X(Rename, "textDocument/rename", Client)                                            \
+    X(PrepareRename, "textDocument/prepareRename", Client)                              \
+    X(LinkedEditingRange, "textDocument/linkedEditingRange", Client)                    \
+    /* Workspace features */                                                            \
+    X(WorkspaceSymbol, "workspace/symbol", Client)                                      \
+    X(WorkspaceSymbolResolve, "workspaceSymbol/resolve", Client)                        \
+    X(Configuration, "workspace/configuration", Server)                                 \
+    X(DidChangeConfiguration, "workspace/didChangeConfiguration", Client)               \
+    X(WorkspaceFolders, "workspace/workspaceFolders", Server)                           \
+    X(DidChangeWorkspaceFolders, "workspace/didChangeWorkspaceFolders", Client)         \
+    X(WillCreateFiles, "workspace/willCreateFiles", Client)                             \
+    X(DidCreateFiles, "workspace/didCreateFiles", Client)                               \
+    X(WillRenameFiles, "workspace/willRenameFiles", Client)                             \
+    X(DidRenameFiles, "workspace/didRenameFiles", Client)                               \
+    X(WillDeleteFiles, "workspace/willDeleteFiles", Client)                             \
+    X(DidDeleteFiles, "workspace/didDeleteFiles", Client)                               \
+    X(DidChangeWatchedFiles, "workspace/didChangeWatchedFiles", Client)                 \
+    X(ExecuteCommand, "workspace/executeCommand", Client)                               \
+    X(ApplyEdit, "workspace/applyEdit", Server)                                         \
+    /* Window features */                                                               \
+    X(ShowMessage, "window/showMessage", Server)                                        \
+    X(ShowMessageRequest, "window/showMessageRequest", Server)                          \
+    X(ShowDocument, "window/showDocument", Server)                                      \
+    X(LogMessage, "window/logMessage", Server)                                          \
+    X(WorkDoneProgressCreate, "window/workDoneProgress/create", Server)                 \
+    X(WorkDoneProgressCancel, "window/workDoneProgress/cancel", Client)                 \
+    X(TelemetryEvent, "telemetry/event", Server)
+
+enum class LspMethod : uint8_t
+{
+#define LSP_METHOD_ENUM(name, string, direction) name,
+    LSP_METHOD_LIST(LSP_METHOD_ENUM)
+#undef LSP_METHOD_ENUM
+    Unknown
+};
+
+constexpr size_t kLspMethodCount = static_cast<size_t>(LspMethod::Unknown);
+
+enum class MethodDirection : uint8_t
+{
+    Client,
+    Server,
+    Both
+};
+
+// Method string -> enum, through a perfect hash generated at compile time (no allocation)
+LspMethod lookupMethod(std::string_view name);
+
+std::string_view methodName(LspMethod method);
+MethodDirection methodDirection(LspMethod method);
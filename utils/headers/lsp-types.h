@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "typed-decode.h"
+
+// Typed LSP structures, decoded straight from params with decodeParams()
+// Member names match the JSON keys, see notes/*.md for the interfaces they come from
+
+struct CancelParams
+{
+    RequestId id;
+};
+LSP_SCHEMA(CancelParams, LSP_FIELD(id))
+
+struct Position
+{
+    uint32_t line = 0;
+    uint32_t character = 0; // in the negotiated position encoding (utf-16 by default)
+};
+LSP_SCHEMA(Position, LSP_FIELD(line), LSP_FIELD(character))
+
+struct Range
+{
+    Position start;
+    Position end;
+};
+LSP_SCHEMA(Range, LSP_FIELD(start), LSP_FIELD(end))
+
+struct TextDocumentIdentifier
+{
+    std::string uri;
+};
+LSP_SCHEMA(TextDocumentIdentifier, LSP_FIELD(uri))
+
+struct VersionedTextDocumentIdentifier
+{
+    std::string uri;
+    int32_t version = 0;
+};
+LSP_SCHEMA(VersionedTextDocumentIdentifier, LSP_FIELD(uri), LSP_FIELD(version))
+
+struct TextDocumentItem
+{
+    std::string uri;
+    std::string languageId;
+    int32_t version = 0;
+    std::string text;
+};
+LSP_SCHEMA(TextDocumentItem, LSP_FIELD(uri), LSP_FIELD(languageId), LSP_FIELD(version), LSP_FIELD(text))
+
+// Either an incremental edit (range set) or the whole new text (range missing)
+struct TextDocumentContentChangeEvent
+{
+    std::optional<Range> range;
+    std::optional<uint32_t> rangeLength;
+    std::string text;
+};
+LSP_SCHEMA(TextDocumentContentChangeEvent, LSP_FIELD(range), LSP_FIELD(rangeLength), LSP_FIELD(text))
+
+struct DidOpenTextDocumentParams
+{
+    TextDocumentItem textDocument;
+};
+LSP_SCHEMA(DidOpenTextDocumentParams, LSP_FIELD(textDocument))
+
+struct DidChangeTextDocumentParams
+{
+    VersionedTextDocumentIdentifier textDocument;
+    std::vector<TextDocumentContentChangeEvent> contentChanges;
+};
+LSP_SCHEMA(DidChangeTextDocumentParams, LSP_FIELD(textDocument), LSP_FIELD(contentChanges))
+
+struct DidCloseTextDocumentParams
+{
+    TextDocumentIdentifier textDocument;
+};
+LSP_SCHEMA(DidCloseTextDocumentParams, LSP_FIELD(textDocument))
+
+struct TextDocumentPositionParams
+{
+    TextDocumentIdentifier textDocument;
+    Position position;
+};
+LSP_SCHEMA(TextDocumentPositionParams, LSP_FIELD(textDocument), LSP_FIELD(position))
+
+// hover, definition, documentHighlight, ... all take exactly these params
+using HoverParams = TextDocumentPositionParams;
+
+struct CompletionContext
+{
+    int32_t triggerKind = 1; // 1 Invoked, 2 TriggerCharacter, 3 TriggerForIncompleteCompletions
+    std::optional<std::string> triggerCharacter;
+};
+LSP_SCHEMA(CompletionContext, LSP_FIELD(triggerKind), LSP_FIELD(triggerCharacter))
+
+struct CompletionParams
+{
+    TextDocumentIdentifier textDocument;
+    Position position;
+    std::optional<CompletionContext> context;
+};
+LSP_SCHEMA(CompletionParams, LSP_FIELD(textDocument), LSP_FIELD(position), LSP_FIELD(context))
+
+// Only the capabilities the server looks at so far
+struct WindowClientCapabilities
+{
+    std::optional<bool> workDoneProgress; // window/workDoneProgress/create is supported
+};
+LSP_SCHEMA(WindowClientCapabilities, LSP_FIELD(workDoneProgress))
+
+struct ClientCapabilities
+{
+    std::optional<WindowClientCapabilities> window;
+};
+LSP_SCHEMA(ClientCapabilities, LSP_FIELD(window))
+
+struct InitializeParams
+{
+    std::optional<ClientCapabilities> capabilities;
+};
+LSP_SCHEMA(InitializeParams, LSP_FIELD(capabilities))
+
+// A progress token is an integer or a string, same as a request id
+struct WorkDoneProgressParams
+{
+    std::optional<RequestId> workDoneToken;
+};
+LSP_SCHEMA(WorkDoneProgressParams, LSP_FIELD(workDoneToken))
+
+struct WorkDoneProgressCancelParams
+{
+    RequestId token;
+};
+LSP_SCHEMA(WorkDoneProgressCancelParams, LSP_FIELD(token))
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// A file created at a fixed size and mapped into memory for writing
+// Appends become plain memcpy into data(), and the page cache writes them out
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Creates (or truncates) path, preallocates `capacity` bytes and maps them
+    bool create(const std::string &path, size_t capacity);
+
+    // Unmaps, trimming the file down to the `used` bytes that were actually written
+    void close(size_t used);
+    void close() { close(mapped_size); }
+
+    // Pushes everything written so far to disk (blocking)
+    void sync();
+
+    bool is_open() const { return mapped != nullptr; }
+    char *data() const { return mapped; }
+    size_t size() const { return mapped_size; }
+
+private:
+    char *mapped = nullptr;
+    size_t mapped_size = 0;
+
+#ifdef _WIN32
+    void *file = nullptr;
+    void *mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
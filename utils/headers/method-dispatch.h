@@ -0,0 +1,117 @@
+#pragma once
+
+#include <string>
+
+#include "JSON-decode.h"
+#include "JSON-writer.h"
+#include "in-flight-table.h"
+#include "lsp-methods.h"
+#include "packet-writer.h"
+#include "params-view.h"
+#include "request-executor.h"
+#include "response-sequencer.h"
+
+// JSON-RPC / LSP error codes used in error responses
+enum class ErrorCode : int
+{
+    ParseError = -32700,
+    InvalidRequest = -32600,
+    MethodNotFound = -32601,
+    InvalidParams = -32602,
+    InternalError = -32603,
+    ServerNotInitialized = -32002,
+    UnknownErrorCode = -32001,
+    RequestFailed = -32803,
+    ServerCancelled = -32802,
+    ContentModified = -32801,
+    RequestCancelled = -32800
+};
+
+// Lifecycle flags the dispatcher gates messages on
+struct ServerState
+{
+    bool initialized = false; // initialize has been answered
+    bool shutdown = false;    // shutdown request received, only exit is accepted from here
+    bool exit = false;        // exit notification received, the main loop should stop
+};
+
+// Everything a handler gets for one message
+// Concurrent requests run on a worker: msg and params belong to that request alone, but state is
+// a copy taken when it was dispatched (lifecycle changes made there are not kept), and anything else
+// the handler reads has to be safe against the main thread carrying on with later messages
+struct RequestContext
+{
+    RequestContext(const Message &msg, ParamsView &params, ServerState &state, JsonWriter &result)
+        : msg(msg), params(params), state(state), result(result)
+    {
+    }
+
+    const Message &msg;
+    ParamsView &params;
+    ServerState &state;
+
+    // Requests only: the result value is written straight into the response body (nothing written = null)
+    // If the handler returns false, whatever was written is dropped and error_code / error_message are sent instead
+    JsonWriter &result;
+    ErrorCode error_code = ErrorCode::InternalError;
+    std::string error_message;
+
+    // Set once the client has sent $/cancelRequest for this request (only ever for Concurrent ones)
+    // Long running handlers should check it between steps, and return false once it is set;
+    // the client is then sent RequestCancelled, whatever error_code says
+    CancellationToken cancel;
+    bool cancelled() const { return cancel.cancelled(); }
+};
+
+// Returns false if the request failed (error_code / error_message are sent back)
+// Notification handlers' return values are ignored
+using MethodHandler = bool (*)(RequestContext &ctx);
+
+// Gets the client's responses to server -> client requests (msg has an id, and result or error, but no method)
+using ResponseHandler = void (*)(const Message &msg);
+
+// Dense handler table indexed by LspMethod
+struct Dispatcher
+{
+    MethodHandler handlers[kLspMethodCount] = {};
+    ResponseHandler on_response = nullptr; // responses are dropped if not set
+};
+
+void registerHandler(Dispatcher &dispatcher, LspMethod method, MethodHandler handler);
+void registerResponseHandler(Dispatcher &dispatcher, ResponseHandler handler);
+
+// How a request is run, see executionPolicy
+enum class Execution : uint8_t
+{
+    Serial,    // on the main thread, in the order it was read, and its response keeps its place
+    Concurrent // independent read-only request, run on a worker, its response may overtake other concurrent ones
+};
+
+// Requests that only read (hover, completion, symbols...) are Concurrent. Lifecycle requests, and ones
+// that hand back edits (rename, formatting, code actions...), are Serial, as the client may apply them
+// before looking at anything answered after them. Notifications are always Serial, so didOpen, didChange
+// and didClose are applied in the order they were sent
+Execution executionPolicy(LspMethod method);
+
+// Which executor lane a Concurrent request is queued on: per keystroke requests are Interactive,
+// editor decorations and pull diagnostics (refreshed in the background, often for offscreen files)
+// are Background, everything else is Normal
+PriorityLane requestLane(LspMethod method);
+
+// Routes one incoming message to its handler, and hands the response (if it is a request) to responses
+// Concurrent requests are moved onto executor, unless it is null, in which case everything runs inline
+// $/cancelRequest is handled here too, it flags the request's cancellation token (see RequestContext)
+// Lifecycle rules:
+// - before initialize, requests get ServerNotInitialized and notifications are dropped (exit excepted)
+// - after shutdown, requests get InvalidRequest
+// - unknown/unhandled requests get MethodNotFound, unknown notifications are dropped
+void dispatchMessage(const Dispatcher &dispatcher, ServerState &state, Message &&msg, ResponseSequencer &responses,
+                     RequestExecutor *executor);
+
+// Replaces body with an error response for request `id` (null if id is)
+void writeErrorResponse(std::string &body, const RequestId &id, ErrorCode code, std::string_view message);
+void writeErrorResponse(std::string &body, const RequestId *id, ErrorCode code, std::string_view message);
+
+// Answers something that couldn't be read as a request, so there is no id to answer to (it is null):
+// a malformed or empty batch, or an invalid element of one. Goes out in order, like any Serial response
+void rejectMessage(ResponseSequencer &responses, ErrorCode code, std::string_view message);
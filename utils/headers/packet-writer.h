@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "JSON-decode.h"
+#include "JSON-encode.h"
+#include "JSON-writer.h"
+#include "transport.h"
+
+// Output stage for outgoing packets
+// Each packet keeps its header and body as separate segments, and everything queued
+// is written with a single gathered write on flush()
+// Packet slots (and their body buffers) are reused across flushes, so steady-state
+// encoding does not allocate
+class PacketWriter
+{
+public:
+    // Encodes msg and queues it, returns false if msg can't be serialised
+    bool enqueue(const Message &msg);
+
+    // Queues a response body built with beginResponseBody / endResponseBody
+    // body is swapped in rather than copied, and comes back empty (with a pooled buffer's capacity)
+    bool enqueue_response(std::string &body);
+
+    // Streaming notifications: begin_notification opens a packet and returns a writer positioned
+    // where its single "params" value goes, commit() queues it, discard() drops it. Only one packet
+    // can be open at a time, and it is kept apart from the queue, so enqueue() may still be used while it is open
+    JsonWriter &begin_notification(std::string_view method);
+    // The same for a server -> client request, which also carries an id for the client's response
+    JsonWriter &begin_request(const RequestId &id, std::string_view method);
+    bool commit();
+    void discard();
+
+    // Batches: responses queued between begin_batch() and end_batch() are collected, in order,
+    // into one array packet which end_batch() queues (nothing, if there were no responses)
+    // Notifications, and anything passed to enqueue(), still go out as packets of their own
+    void begin_batch();
+    bool end_batch();
+
+    // Writes all queued packets, in order, returns false if the transport is closed
+    bool flush(Transport &out);
+
+    // Moves the queued packets over to `to`, which must have none queued, and takes its pooled slots in exchange
+    // So packets can be written from `to` while more are queued here
+    void hand_over(PacketWriter &to);
+
+    size_t pending() const { return queued; }
+
+    // Total size of the queued packets, headers included
+    size_t pending_bytes() const;
+
+private:
+    struct Packet
+    {
+        char header[kLspHeaderCapacity];
+        size_t header_size = 0;
+        std::string body;
+    };
+
+    // Slots [0, queued) are waiting to be written, the rest are pooled
+    std::vector<Packet> packets;
+    size_t queued = 0;
+
+    std::vector<std::string_view> segments;
+
+    // The packet being streamed by begin_* / commit
+    std::string open_body;
+    JsonWriter open_writer;
+    bool open = false;
+
+    // Responses collected since begin_batch
+    std::string batch_body;
+    size_t batch_responses = 0;
+    bool batching = false;
+
+    Packet &acquire();
+    bool queue_body(std::string &body);
+};
+
+// Response bodies are built apart from the PacketWriter (a request may be answered on a worker thread)
+// beginResponseBody writes {"jsonrpc":"2.0","id":<id>,"<member>": and leaves json waiting for the value,
+// where member is "result" or "error". endResponseBody closes it (nothing written means null)
+// A null id is for errors about messages whose id couldn't be read
+void beginResponseBody(JsonWriter &json, const RequestId &id, std::string_view member);
+void beginResponseBody(JsonWriter &json, const RequestId *id, std::string_view member);
+void endResponseBody(JsonWriter &json);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Lazy, read-only view over a raw params value
+// Paths are JSON pointers (RFC 6901) relative to params, e.g. "/textDocument/uri" or "/contentChanges/0/text"
+// Nothing is built up front: a lookup only descends into the values on its path, the subtrees beside
+// them are skipped over without being decoded
+// Each object on the path is scanned to its end, so a duplicated name resolves to its last value
+// Where each resolved path (and its prefixes) starts is cached, so "/position/line" then
+// "/position/character" only searches params for "/position" once
+class ParamsView
+{
+public:
+    explicit ParamsView(std::string_view params_json);
+
+    // Raw JSON text of the value at pointer (e.g. "\"file:///a.go\"", "{...}", "42")
+    bool find(std::string_view pointer, std::string_view &out_raw);
+
+    bool has(std::string_view pointer);
+    bool get_string(std::string_view pointer, std::string &out);
+    bool get_int(std::string_view pointer, long long &out);
+    bool get_double(std::string_view pointer, double &out);
+    bool get_bool(std::string_view pointer, bool &out);
+    bool is_null(std::string_view pointer);
+
+private:
+    // Fixed size so lookups never allocate, paths longer than kMaxCachedPath just aren't cached
+    static constexpr size_t kCacheSize = 16;
+    static constexpr size_t kMaxCachedPath = 47;
+
+    struct CacheEntry
+    {
+        char path[kMaxCachedPath];
+        uint8_t path_size = 0;
+        uint32_t begin = 0; // start of the value
+    };
+
+    std::string_view source;
+    CacheEntry cache[kCacheSize];
+    size_t cache_used = 0;
+    size_t cache_next = 0; // round-robin replacement once full
+
+    bool cache_lookup(std::string_view path, size_t &begin) const;
+    void cache_store(std::string_view path, size_t begin);
+};
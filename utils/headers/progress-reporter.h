@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "JSON-decode.h"
+#include "in-flight-table.h"
+#include "request-id.h"
+#include "response-sequencer.h"
+
+class ProgressReporter;
+
+// Progress tokens are integers or strings, like request ids
+using ProgressToken = RequestId;
+
+// One long job's work done progress (indexing, diagnosing a whole workspace...), see ProgressReporter::begin
+// The job only stores into atomics here (set_message aside), it never waits on the reporter or the output
+class ProgressTask
+{
+public:
+    ProgressTask(ProgressReporter &owner, std::string title, size_t parts, bool cancellable);
+
+    ProgressTask(const ProgressTask &) = delete;
+    ProgressTask &operator=(const ProgressTask &) = delete;
+
+    // Part `part` (of the parts given to begin) is `fraction` done, 0 to 1
+    // The job is as far along as the mean of its parts, so parallel sub-tasks each keep their own part
+    // Cheap enough to call per item, reports are only sent at the reporter's pace
+    void update(size_t part, double fraction);
+
+    // Shown with the next report, e.g. the file being looked at
+    void set_message(std::string_view message);
+
+    // The user cancelled the job (window/workDoneProgress/cancel), only ever set if it was begun cancellable
+    bool cancelled() const { return cancel_flag.load(std::memory_order_relaxed); }
+    CancellationToken cancellation() const { return CancellationToken(&cancel_flag); }
+
+    // The job is done (or gave up). The end notification replaces any report still pending,
+    // updates after this are ignored
+    void finish(std::string_view message = {});
+
+    // Mean of the parts, 0 to 100
+    uint32_t percentage() const;
+
+private:
+    friend class ProgressReporter;
+
+    enum class State : uint8_t
+    {
+        Create,   // the server's own token, window/workDoneProgress/create hasn't been sent yet
+        Creating, // waiting for the client to accept the token, dropped if the job finishes first
+        Ready,    // the token can be used, begin hasn't been sent yet
+        Active,   // begun, reports go out until finish
+        Disabled  // nobody to report to (the client can't create tokens, or refused this one)
+    };
+
+    ProgressReporter &owner;
+    const std::string title;
+    const bool cancellable;
+    const size_t part_count;
+    std::unique_ptr<std::atomic<uint32_t>[]> parts; // hundredths of a percent, 0 to 10000
+    std::atomic<bool> cancel_flag{false};
+    std::atomic<bool> finished{false};
+
+    std::mutex text_mutex; // message, message_changed and end_message
+    std::string message;
+    bool message_changed = false;
+    std::string end_message;
+
+    // Only touched by the reporter, under its lock
+    ProgressToken token;
+    State state = State::Disabled;
+    uint32_t reported = 0; // percentage last sent, reports never go backwards
+    std::chrono::steady_clock::time_point last_sent;
+};
+
+// $/progress for server side jobs (see notes/Base-Protocol.md, notes/Window-features.md)
+// - a job reports against the workDoneToken its request came with, or else against a token of the server's own,
+//   negotiated with window/workDoneProgress/create (if the client said it supports that in initialize)
+// - begin and end go out as soon as they can, reports at most once per `interval` per token, and only
+//   if something changed. Updates in between just overwrite each other, so however fast a job updates,
+//   the client sees one small packet per interval
+// - everything is sent from a thread of the reporter's own: the job never formats, queues or waits on
+//   output. If the client stops reading, the ticker's flush blocks like any other flush, but with neither
+//   the reporter's lock nor the sequencer's held, so jobs and responses carry on queuing
+class ProgressReporter
+{
+public:
+    explicit ProgressReporter(ResponseSequencer &responses,
+                              std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter &) = delete;
+    ProgressReporter &operator=(const ProgressReporter &) = delete;
+
+    // From the client's window.workDoneProgress capability
+    void set_client_support(bool supported);
+
+    // Starts reporting a job split into `parts` parallel sub-tasks (at least 1)
+    // token is the request's workDoneToken, if it had one. The task is always usable, it just
+    // isn't shown if there is nothing to report to
+    std::shared_ptr<ProgressTask> begin(std::string_view title, const std::optional<ProgressToken> &token,
+                                        size_t parts = 1, bool cancellable = false);
+
+    // Takes the client's response to a window/workDoneProgress/create, false if msg isn't one
+    // (or it came after the task had already finished, and been dropped)
+    bool handle_response(const Message &msg);
+
+    // window/workDoneProgress/cancel
+    void cancel(const ProgressToken &token);
+
+    // Sends end for every task the client is showing, then nothing more (shutdown)
+    // Tasks still running carry on unreported
+    void stop();
+
+private:
+    friend class ProgressTask;
+
+    using Clock = std::chrono::steady_clock;
+
+    // One packet for the ticker to send, worked out under the lock and sent outside it
+    struct Send
+    {
+        enum class Kind : uint8_t
+        {
+            Create,
+            Begin,
+            Report,
+            End
+        };
+
+        Kind kind = Kind::Report;
+        std::shared_ptr<ProgressTask> task;
+        RequestId request; // Create
+        uint32_t percentage = 0;
+        std::optional<std::string> message;
+    };
+
+    ResponseSequencer &responses;
+    const std::chrono::milliseconds interval;
+
+    std::mutex mutex;
+    std::condition_variable wake; // a task was begun, accepted or finished, or the reporter is stopping
+    std::vector<std::shared_ptr<ProgressTask>> tasks;
+    std::vector<std::pair<RequestId, std::shared_ptr<ProgressTask>>> creating; // create requests awaiting a response
+    bool client_support = false;
+    bool stopping = false;
+    long long next_request = 1;
+    uint64_t next_token = 1;
+    std::thread ticker; // started by the first task that has something to report to
+
+    void finished(); // ProgressTask::finish
+    void ticker_loop();
+    void send(const Send &packet);
+};
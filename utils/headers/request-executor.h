@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "in-flight-table.h"
+
+// Latency classes, highest priority first. Requests get theirs from the method (see requestLane)
+enum class PriorityLane : uint8_t
+{
+    Interactive, // typed-into-the-editor requests: completion, hover, signatureHelp...
+    Normal,      // user asked, but not per keystroke: definition, references, symbols...
+    Background   // nobody is waiting on it right now: pull diagnostics, semantic tokens, indexing...
+};
+
+constexpr size_t kLaneCount = 3;
+
+std::string_view laneName(PriorityLane lane);
+
+// Snapshot of one lane, for tuning
+// Wait is from being queued (or, for a chunked job, from its previous chunk) to a worker starting on it
+struct LaneStats
+{
+    size_t depth = 0;          // queued right now
+    uint64_t started = 0;      // chunks started so far (a plain task is one chunk)
+    uint64_t mean_wait_us = 0;
+    uint64_t p99_wait_us = 0;  // upper bound, waits are kept in power of two buckets
+    uint64_t max_wait_us = 0;
+};
+
+// Long-lived worker threads that run whole requests, and background jobs, off the main thread
+// submit() returns straight away, parallel_for() splits one job into pieces and waits for them
+//
+// Scheduling:
+// - every worker has its own queue per lane; new work is spread round robin (or kept on the submitting worker),
+//   and an idle worker steals from the others, oldest first
+// - a worker always takes the highest priority lane that has anything queued anywhere, so interactive work
+//   never sits behind background work that hasn't started yet
+// - chunked jobs go back through the lanes after every chunk, so a long background job is preempted
+//   at its next chunk boundary by anything of a higher priority that was queued meanwhile
+// Threads are only started by the first submit
+class RequestExecutor
+{
+public:
+    // 0 picks one less than the number of hardware threads (the main thread keeps reading), but at least 1
+    explicit RequestExecutor(size_t threads = 0);
+    // Runs whatever is still queued before the workers are joined
+    ~RequestExecutor();
+
+    RequestExecutor(const RequestExecutor &) = delete;
+    RequestExecutor &operator=(const RequestExecutor &) = delete;
+
+    void submit(PriorityLane lane, std::function<void()> task);
+
+    // step() is run over and over (one chunk each time) until it returns false
+    // Any thread may submit, a worker keeps the job in its own queue
+    void submit_chunked(PriorityLane lane, std::function<bool()> step);
+
+    // Runs task(i) for every i in [0, count), on the workers (Interactive lane, the caller is waiting)
+    // and the calling thread, and returns once all of them have finished
+    // Indices are handed out one at a time, so uneven pieces still spread evenly
+    void parallel_for(size_t count, const std::function<void(size_t)> &task);
+
+    // Blocks until every submitted task and job has finished
+    void wait_idle();
+
+    size_t size() const { return thread_count; }
+
+    LaneStats lane_stats(PriorityLane lane) const;
+
+    // Requests submitted here that haven't answered yet, for $/cancelRequest
+    InFlightTable &in_flight() { return requests; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job
+    {
+        std::function<bool()> step;
+        PriorityLane lane = PriorityLane::Normal;
+        Clock::time_point queued;
+    };
+
+    // One per worker. Everyone takes from the front (oldest first), chunked jobs are put back at the front
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Job> lanes[kLaneCount];
+    };
+
+    // Power of two microsecond buckets, 2^31 us (~36 minutes) and up all land in the last one
+    static constexpr size_t kWaitBuckets = 32;
+
+    struct LaneCounters
+    {
+        std::atomic<size_t> depth{0};
+        std::atomic<uint64_t> started{0};
+        std::atomic<uint64_t> wait_total_us{0};
+        std::atomic<uint64_t> wait_max_us{0};
+        std::array<std::atomic<uint64_t>, kWaitBuckets> wait_buckets{};
+    };
+
+    InFlightTable requests;
+
+    size_t thread_count = 0;
+    std::vector<std::unique_ptr<WorkerQueue>> queues; // one per worker, made up front
+    std::vector<std::thread> workers;
+    std::once_flag started;
+    std::atomic<size_t> next_queue{0};
+    LaneCounters lanes[kLaneCount];
+
+    // Sleeping and waiting, queued/outstanding only change under this lock
+    std::mutex mutex;
+    std::condition_variable wake; // something was queued, or the executor is stopping
+    std::condition_variable idle; // the last outstanding job finished
+    size_t queued = 0;      // jobs sitting in a queue, counted just before they are pushed
+    size_t outstanding = 0; // jobs submitted and not finished (a chunked job counts once)
+    bool stopping = false;
+
+    void start();
+    void push(Job job, bool front);
+    bool take(size_t self, Job &job);
+    void record_wait(const Job &job);
+    void worker_loop(size_t self);
+};
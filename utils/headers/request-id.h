@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// JSON-RPC request id, which is either an integer or a string
+// Clients send small integers or short strings (counters, "req-12", uuids), so strings up to
+// kInlineCapacity bytes live inside the id itself, and only longer ones go on the heap
+class RequestId
+{
+public:
+    static constexpr size_t kInlineCapacity = 22;
+
+    RequestId() = default;
+    RequestId(long long number) : number_value(number) {}
+    explicit RequestId(std::string_view text) { assign(text); }
+
+    void assign(long long number);
+    void assign(std::string_view text);
+
+    bool is_string() const { return kind != Kind::Number; }
+    long long number() const { return number_value; }
+    std::string_view text() const;
+
+    // Equal ids hash the same, for the in-flight table
+    uint64_t hash() const;
+
+    bool operator==(const RequestId &other) const;
+    bool operator!=(const RequestId &other) const { return !(*this == other); }
+
+private:
+    enum class Kind : uint8_t
+    {
+        Number,
+        Inline,
+        Heap
+    };
+
+    Kind kind = Kind::Number;
+    uint8_t inline_size = 0;
+    char inline_text[kInlineCapacity] = {};
+    long long number_value = 0;
+    std::string heap_text;
+};
+
+// Log formatting (see LSP_LOG), string ids are quoted
+void appendLogArg(std::string &out, const RequestId &id);
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "packet-writer.h"
+#include "transport.h"
+
+// Puts responses back into an order the client can rely on (see notes/Base-Protocol.md)
+// Every request takes a ticket in the order it was read, and its response is held until it may go out:
+// - ordered tickets wait for every earlier response (anything that edits, or depends on what came before)
+// - unordered tickets (independent read-only requests) only wait for earlier ordered ones,
+//   so they can overtake each other, but never jump a rename/shutdown that was sent before them
+// Packets are queued under the sequencer's lock, so responses can be completed (and flushed) from any thread
+// flush() writes them with that lock dropped: a client that stops reading blocks the threads flushing,
+// but completing, notifying and reserving never wait on it
+class ResponseSequencer
+{
+public:
+    explicit ResponseSequencer(Transport &out);
+
+    ResponseSequencer(const ResponseSequencer &) = delete;
+    ResponseSequencer &operator=(const ResponseSequencer &) = delete;
+
+    // Takes the next ticket, call in the order the requests were read
+    uint64_t reserve(bool ordered);
+
+    // Hands over the response for ticket (built with beginResponseBody), and queues everything it was holding up
+    // body is swapped out and comes back empty. An empty body retires the ticket without a response
+    void complete(uint64_t ticket, std::string &body);
+
+    // Queues a server -> client notification, write_params(JsonWriter &) writes its single "params" value
+    // Notifications don't take a ticket, they are queued straight away, in between released responses
+    template <typename WriteParams>
+    bool notify(std::string_view method, WriteParams &&write_params)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        write_params(writer.begin_notification(method));
+        return writer.commit();
+    }
+
+    // Queues a server -> client request the same way, the client's response comes back without a method
+    // (see Dispatcher::on_response)
+    template <typename WriteParams>
+    bool request(const RequestId &id, std::string_view method, WriteParams &&write_params)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        write_params(writer.begin_request(id, method));
+        return writer.commit();
+    }
+
+    // Writes everything released so far, returns false if the transport is closed
+    // One flush writes at a time, so packets go out in the order they were queued
+    bool flush();
+
+    // Blocks until every ticket taken so far has been released (or retired), e.g. requests still running on workers
+    // Only waits on requests, not on anything else the executor is doing
+    void wait_released();
+
+    // See PacketWriter::begin_batch, only responses released in between are collected
+    void begin_batch();
+    bool end_batch();
+
+private:
+    struct Slot
+    {
+        std::string body;
+        bool ordered = false;
+        bool done = false;
+        bool released = false;
+    };
+
+    std::mutex mutex;
+    std::condition_variable all_released; // first caught up with next
+    Transport &out;
+    PacketWriter writer;
+
+    std::mutex write_mutex; // taken before mutex, never after it
+    PacketWriter sending;   // what the current flush is writing, under write_mutex
+
+    // Ring of the tickets [first, next) that haven't all been released, indexed by ticket % size
+    std::vector<Slot> slots;
+    uint64_t first = 0;
+    uint64_t next = 0;
+
+    Slot &slot(uint64_t ticket) { return slots[ticket % slots.size()]; }
+    void grow();
+    void release_ready();
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "lsp-methods.h"
+#include "request-id.h"
+
+/*
+Binary trace log
+
+A compact record of what happened to every message, for reproducing latency problems offline
+(decode / replay it with tools/lsp-trace.cpp). Written alongside the text log, never instead of it
+
+File layout (little endian, everything 8 byte aligned):
+    TraceFileHeader
+    TraceRecord, [body bytes, padded to 8]
+    TraceRecord, [body bytes, padded to 8]
+    ...
+A record with timestamp 0 marks the end (the preallocated tail of the file is zeroes)
+*/
+
+enum class TracePhase : uint8_t
+{
+    Receive = 1,  // frame read off the transport (body_size = body bytes)
+    Decode = 2,   // body decoded into a Message
+    Dispatch = 3, // handler finished, on whichever thread ran it (body_size = response bytes, 0 if none)
+    Respond = 4   // queued packets written to the transport (body_size = bytes written)
+};
+
+enum class TraceIdKind : uint8_t
+{
+    None = 0,
+    Number = 1,
+    String = 2 // truncated to kTraceIdText bytes
+};
+
+constexpr char kTraceMagic[8] = {'L', 'S', 'P', 'T', 'R', 'A', 'C', 'E'};
+constexpr uint32_t kTraceVersion = 1;
+constexpr size_t kTraceIdText = 16;
+constexpr size_t kDefaultTraceCapacity = 64 * 1024 * 1024;
+
+struct TraceFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;     // sizeof(TraceFileHeader)
+    uint64_t start_unix_ns;   // wall clock at openTrace, record timestamps are relative to it
+    uint64_t used_bytes;      // filled in by closeTrace (0 if the process died first)
+    uint64_t dropped_records; // records that didn't fit in the segment
+};
+
+struct TraceRecord
+{
+    uint64_t timestamp_ns; // steady clock, since openTrace (always > 0)
+    uint32_t body_size;
+    uint32_t raw_size; // bytes of message body following this record (0 if not captured)
+    TracePhase phase;
+    LspMethod method;
+    TraceIdKind id_kind;
+    uint8_t id_size;
+    uint32_t reserved;
+    union
+    {
+        int64_t id_number;
+        char id_text[kTraceIdText];
+    };
+};
+
+static_assert(sizeof(TraceFileHeader) == 40, "trace header layout changed");
+static_assert(sizeof(TraceRecord) == 40, "trace record layout changed");
+
+// Starts tracing into a preallocated, memory mapped segment of `capacity` bytes
+// capture_bodies also stores every received message body (needed for replay)
+bool openTrace(const std::string &path, bool capture_bodies, size_t capacity = kDefaultTraceCapacity);
+
+// Stops tracing and trims the file to what was written
+// Safe while other threads are still tracing, it waits for any record being written to finish
+void closeTrace();
+
+namespace trace_detail
+{
+    extern std::atomic<bool> active;
+}
+
+inline bool traceEnabled()
+{
+    return trace_detail::active.load(std::memory_order_relaxed);
+}
+
+// Appends one record (safe from any thread), raw is only kept if bodies are being captured
+// Cheap enough to leave in: a relaxed load when tracing is off, a reservation + memcpy when on
+void traceEvent(TracePhase phase, LspMethod method, const RequestId *id, size_t body_size, std::string_view raw = {});
+
+// Short name of a phase, for decoded output
+const char *tracePhaseName(TracePhase phase);
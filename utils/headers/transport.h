@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string_view>
+
+// Raw byte source/sink that the LSP framing sits on top of
+class Transport
+{
+public:
+    virtual ~Transport() = default;
+
+    // Reads at least min_bytes (and up to capacity, if they are already available) into dst
+    // Returns the number of bytes read, which is only less than min_bytes on EOF/error
+    virtual size_t read_some(char *dst, size_t min_bytes, size_t capacity) = 0;
+
+    // Writes every byte, returns false if the output is closed/unwritable
+    virtual bool write_all(const char *data, size_t size) = 0;
+
+    // Writes each segment in order, as if they were one contiguous buffer
+    // Backends that can gather (writev) should override this
+    virtual bool write_segments(const std::string_view *segments, size_t count);
+};
+
+// Fallback over iostreams (used on Windows)
+class StreamTransport : public Transport
+{
+public:
+    StreamTransport(std::istream &in, std::ostream &out);
+
+    size_t read_some(char *dst, size_t min_bytes, size_t capacity) override;
+    bool write_all(const char *data, size_t size) override;
+
+private:
+    std::istream &in;
+    std::ostream &out;
+};
+
+#ifndef _WIN32
+// Raw file descriptor backend, reads and writes go straight through read(2)/write(2)
+// The fds' flags are left alone (stdin/stdout are shared with the parent, and a crash couldn't put
+// them back), but if they were handed over non-blocking, the transport waits on poll(2) when they aren't ready
+class FdTransport : public Transport
+{
+public:
+    FdTransport(int in_fd, int out_fd);
+
+    FdTransport(const FdTransport &) = delete;
+    FdTransport &operator=(const FdTransport &) = delete;
+
+    size_t read_some(char *dst, size_t min_bytes, size_t capacity) override;
+    bool write_all(const char *data, size_t size) override;
+    bool write_segments(const std::string_view *segments, size_t count) override;
+
+private:
+    int in_fd;
+    int out_fd;
+};
+#endif
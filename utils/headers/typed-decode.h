@@ -0,0 +1,351 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "JSON-scan.h"
+#include "request-id.h"
+
+/*
+Schema-driven decoding of params straight into typed structs
+
+Each struct lists its fields once, through LSP_SCHEMA / LSP_FIELD (see lsp-types.h):
+
+    LSP_SCHEMA(Position, LSP_FIELD(line), LSP_FIELD(character))
+
+The decoder walks the raw JSON once. Every key is hashed as it is read, and matched against the
+field hashes computed at compile time, so there is no intermediate tree and no string compares
+beyond confirming a hash hit. Unknown keys are skipped. Values are decoded directly into the
+member, and a value of the wrong JSON type fails the decode. So does a missing required field
+(std::optional members are optional).
+*/
+
+namespace typed_decode
+{
+    // FNV-1a, usable at compile time for the field names
+    constexpr uint64_t key_hash(std::string_view key)
+    {
+        uint64_t h = 14695981039346656037ULL;
+        for (char c : key)
+        {
+            h ^= static_cast<unsigned char>(c);
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    template <typename T>
+    struct is_optional : std::false_type
+    {
+    };
+    template <typename T>
+    struct is_optional<std::optional<T>> : std::true_type
+    {
+    };
+
+    template <typename Owner, typename Member>
+    struct Field
+    {
+        std::string_view name;
+        uint64_t hash;
+        Member Owner::*member;
+    };
+
+    template <typename Owner, typename Member>
+    constexpr Field<Owner, Member> field(std::string_view name, Member Owner::*member)
+    {
+        return Field<Owner, Member>{name, key_hash(name), member};
+    }
+
+    // Specialised for every decodable struct, through LSP_SCHEMA
+    template <typename T>
+    struct Schema;
+
+    template <typename T, typename = void>
+    struct has_schema : std::false_type
+    {
+    };
+    template <typename T>
+    struct has_schema<T, std::void_t<decltype(Schema<T>::fields)>> : std::true_type
+    {
+    };
+
+    // Leaf decoders -- each one expects the cursor on the value, and leaves it just past it
+
+    inline bool decode(std::string_view s, size_t &i, bool &out)
+    {
+        if (json_scan::parse_literal(s, i, "true"))
+            out = true;
+        else if (json_scan::parse_literal(s, i, "false"))
+            out = false;
+        else
+            return false;
+        return true;
+    }
+
+    inline bool decode(std::string_view s, size_t &i, std::string &out)
+    {
+        size_t start = i;
+        bool escaped = false;
+        if (!json_scan::scan_string(s, i, escaped))
+            return false;
+
+        std::string_view raw = s.substr(start + 1, i - start - 2);
+        if (!escaped)
+        {
+            out.assign(raw.data(), raw.size());
+            return true;
+        }
+        return json_scan::decode_string(raw, out);
+    }
+
+    // LSP integer / uinteger, and anything else integral
+    template <typename T>
+    std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, bool>
+    decode(std::string_view s, size_t &i, T &out)
+    {
+        size_t start = i;
+        long long value = 0;
+        if (!json_scan::scan_number(s, i) || !json_scan::to_integer(s.substr(start, i - start), value))
+            return false;
+
+        // Anything that isn't a whole number in range for T is a type mismatch
+        if constexpr (std::is_unsigned_v<T>)
+        {
+            if (value < 0 || static_cast<unsigned long long>(value) > std::numeric_limits<T>::max())
+                return false;
+        }
+        else
+        {
+            if (value < std::numeric_limits<T>::min() || value > std::numeric_limits<T>::max())
+                return false;
+        }
+        out = static_cast<T>(value);
+        return true;
+    }
+
+    inline bool decode(std::string_view s, size_t &i, double &out)
+    {
+        size_t start = i;
+        return json_scan::scan_number(s, i) && json_scan::to_double(s.substr(start, i - start), out);
+    }
+
+    // JSON-RPC ids (CancelParams, progress tokens): integer | string
+    inline bool decode(std::string_view s, size_t &i, RequestId &out)
+    {
+        if (i < s.size() && s[i] == '"')
+        {
+            size_t start = i;
+            bool escaped = false;
+            if (!json_scan::scan_string(s, i, escaped))
+                return false;
+
+            std::string_view raw = s.substr(start + 1, i - start - 2);
+            if (!escaped)
+            {
+                out.assign(raw);
+                return true;
+            }
+
+            std::string text;
+            if (!json_scan::decode_string(raw, text))
+                return false;
+            out.assign(text);
+            return true;
+        }
+
+        long long number = 0;
+        if (!decode(s, i, number))
+            return false;
+        out.assign(number);
+        return true;
+    }
+
+    template <typename T>
+    std::enable_if_t<has_schema<T>::value, bool> decode(std::string_view s, size_t &i, T &out);
+
+    // Missing and null both mean "not there"
+    template <typename T>
+    bool decode(std::string_view s, size_t &i, std::optional<T> &out)
+    {
+        if (json_scan::parse_literal(s, i, "null"))
+        {
+            out.reset();
+            return true;
+        }
+        out.emplace();
+        return decode(s, i, *out);
+    }
+
+    template <typename T>
+    bool decode(std::string_view s, size_t &i, std::vector<T> &out)
+    {
+        if (i >= s.size() || s[i] != '[')
+            return false;
+        ++i;
+
+        out.clear();
+        json_scan::skip_ws(s, i);
+        if (i < s.size() && s[i] == ']')
+        {
+            ++i;
+            return true;
+        }
+
+        while (i < s.size())
+        {
+            json_scan::skip_ws(s, i);
+            out.emplace_back();
+            if (!decode(s, i, out.back()))
+                return false;
+
+            json_scan::skip_ws(s, i);
+            if (i >= s.size())
+                return false;
+            if (s[i] == ',')
+            {
+                ++i;
+                continue;
+            }
+            if (s[i] == ']')
+            {
+                ++i;
+                return true;
+            }
+            return false;
+        }
+        return false;
+    }
+
+    // Decodes the value of `key` if it is one of T's fields, marking it in `seen`
+    // Returns false on a decode failure, sets `matched` if the key belonged to T
+    template <typename T>
+    bool decode_field(std::string_view s, size_t &i, T &out, std::string_view key, uint64_t hash,
+                      uint64_t &seen, bool &matched)
+    {
+        bool ok = true;
+        size_t index = 0;
+        std::apply(
+            [&](const auto &...fields) {
+                // Stops at the first field whose hash (then name) matches
+                (void)((fields.hash == hash && fields.name == key
+                            ? (matched = true, seen |= 1ULL << index, ok = decode(s, i, out.*(fields.member)), true)
+                            : (++index, false)) ||
+                       ...);
+            },
+            Schema<T>::fields);
+        return ok;
+    }
+
+    // Bit mask of the fields that have to be present
+    template <typename T>
+    constexpr uint64_t required_mask()
+    {
+        uint64_t mask = 0;
+        size_t index = 0;
+        std::apply(
+            [&](const auto &...fields) {
+                ((mask |= is_optional<std::remove_reference_t<decltype(std::declval<T &>().*(fields.member))>>::value
+                              ? 0
+                              : 1ULL << index,
+                  ++index),
+                 ...);
+            },
+            Schema<T>::fields);
+        return mask;
+    }
+
+    template <typename T>
+    std::enable_if_t<has_schema<T>::value, bool> decode(std::string_view s, size_t &i, T &out)
+    {
+        static_assert(std::tuple_size_v<std::remove_const_t<decltype(Schema<T>::fields)>> <= 64, "too many fields");
+
+        if (i >= s.size() || s[i] != '{')
+            return false;
+        ++i;
+
+        uint64_t seen = 0;
+        std::string decoded_key;
+
+        json_scan::skip_ws(s, i);
+        if (i < s.size() && s[i] == '}')
+        {
+            ++i;
+            return (seen & required_mask<T>()) == required_mask<T>();
+        }
+
+        while (i < s.size())
+        {
+            json_scan::skip_ws(s, i);
+            size_t key_start = i;
+            bool escaped = false;
+            if (!json_scan::scan_string(s, i, escaped))
+                return false;
+
+            std::string_view key = s.substr(key_start + 1, i - key_start - 2);
+            if (escaped)
+            {
+                if (!json_scan::decode_string(key, decoded_key))
+                    return false;
+                key = decoded_key;
+            }
+
+            json_scan::skip_ws(s, i);
+            if (i >= s.size() || s[i] != ':')
+                return false;
+            ++i;
+            json_scan::skip_ws(s, i);
+
+            bool matched = false;
+            if (!decode_field(s, i, out, key, key_hash(key), seen, matched))
+                return false;
+            if (!matched && !json_scan::skip_value(s, i))
+                return false;
+
+            json_scan::skip_ws(s, i);
+            if (i >= s.size())
+                return false;
+            if (s[i] == ',')
+            {
+                ++i;
+                continue;
+            }
+            if (s[i] == '}')
+            {
+                ++i;
+                return (seen & required_mask<T>()) == required_mask<T>();
+            }
+            return false;
+        }
+        return false;
+    }
+}
+
+// Decodes a whole params document into out
+template <typename T>
+bool decodeParams(std::string_view params_json, T &out)
+{
+    size_t i = 0;
+    json_scan::skip_ws(params_json, i);
+    if (!typed_decode::decode(params_json, i, out))
+        return false;
+    json_scan::skip_ws(params_json, i);
+    return i == params_json.size();
+}
+
+// Schema declaration helpers, used at namespace scope
+#define LSP_FIELD(name) typed_decode::field(#name, &Type::name)
+#define LSP_SCHEMA(type, ...)                                    \
+    template <>                                                  \
+    struct typed_decode::Schema<type>                            \
+    {                                                            \
+        using Type = type;                                       \
+        static constexpr auto fields = std::make_tuple(__VA_ARGS__); \
+    };
@@ -0,0 +1,55 @@
+#include "headers/in-flight-table.h"
+
+static_assert((InFlightTable::kCapacity & (InFlightTable::kCapacity - 1)) == 0, "capacity must be a power of two");
+
+size_t InFlightTable::insert(const RequestId &id)
+{
+    uint64_t hash = id.hash();
+    for (size_t probe = 0; probe < kProbe; ++probe)
+    {
+        size_t index = (hash + probe) & (kCapacity - 1);
+        Slot &slot = slots[index];
+
+        // Acquire pairs with release(), the worker is done with the slot once it reads as free
+        if (slot.used.load(std::memory_order_acquire))
+            continue;
+
+        slot.hash = hash;
+        slot.id = id;
+        slot.cancelled.store(false, std::memory_order_relaxed);
+        slot.used.store(true, std::memory_order_release);
+        return index;
+    }
+    return kNoSlot;
+}
+
+// Every slot in the window is checked, not just up to the first free one, so released slots
+// never have to be marked as anything but free
+bool InFlightTable::cancel(const RequestId &id)
+{
+    uint64_t hash = id.hash();
+    for (size_t probe = 0; probe < kProbe; ++probe)
+    {
+        Slot &slot = slots[(hash + probe) & (kCapacity - 1)];
+        if (!slot.used.load(std::memory_order_acquire) || slot.hash != hash || slot.id != id)
+            continue;
+
+        // If the worker answers in the meantime the flag just goes unread, insert() resets it
+        slot.cancelled.store(true, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void InFlightTable::release(size_t slot)
+{
+    if (slot < kCapacity)
+        slots[slot].used.store(false, std::memory_order_release);
+}
+
+CancellationToken InFlightTable::token(size_t slot) const
+{
+    if (slot >= kCapacity)
+        return CancellationToken();
+    return CancellationToken(&slots[slot].cancelled);
+}
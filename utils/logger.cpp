@@ -10,20 +10,49 @@
 // Both eventType and logSeverity should corrospond to std::strings
 
 #include "headers/logger.h"
+#include "headers/mapped-file.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
 #include <ctime>
 #include <filesystem>
-#include <fstream>
-#include <sstream>
+#include <mutex>
+#include <thread>
+
+// Events are not written by the thread that logs them
+// logEvent copies the event into a slot of a fixed ring buffer (a handful of stores), and a
+// background thread drains the ring into one long-lived file handle, a batch at a time
+// Nothing on the request path opens files, formats times, or waits on the writer
+
+// The log is a series of fixed size segments (log-<start>.txt, log-<start>.1.txt, ...)
+// Each one is preallocated and memory mapped, so writing a batch is a memcpy
+// When a segment fills up the writer moves on to the next, and deletes the oldest once there are
+// more than LogRotation::segment_count of them, so a long session can't grow the log forever
+// (A segment is trimmed to its contents when it is closed, until then its unwritten tail reads as zeroes)
 
 namespace
 {
+    // localtime_s is MSVC only (and its arguments are the other way round to C11's), POSIX has localtime_r
+    bool local_time(std::time_t time, std::tm& out)
+    {
+#ifdef _WIN32
+        return localtime_s(&out, &time) == 0;
+#else
+        return localtime_r(&time, &out) != nullptr;
+#endif
+    }
+
     bool format_current_time(const char* format, std::string& out)
     {
         // Output current time into out, based on format
         std::time_t now = std::time(nullptr);
         std::tm tm_value{};
-        if (localtime_s(&tm_value, &now) != 0)
+        if (!local_time(now, tm_value))
             return false;
 
         char buffer[64];
@@ -69,31 +98,332 @@ namespace
         }
         return "Unknown";
     }
+
+    // Log line timestamps, "YYYY-MM-DD HH:MM:SS.uuuuuu"
+    // Events carry a steady_clock reading (cheap to take), which is turned into wall time against an
+    // anchor pair. The date/time part only changes once a second, so localtime/strftime run at most
+    // once a second, and the microseconds are appended by hand
+    class TimestampCache
+    {
+    public:
+        TimestampCache() { reanchor(); }
+
+        // Keeps wall clock adjustments (NTP etc.) from drifting the converted times
+        void reanchor()
+        {
+            anchor_wall = std::chrono::system_clock::now();
+            anchor_steady = std::chrono::steady_clock::now();
+        }
+
+        void append(std::chrono::steady_clock::time_point when, std::string& out)
+        {
+            auto wall = anchor_wall.time_since_epoch() + (when - anchor_steady);
+            long long micros = std::chrono::duration_cast<std::chrono::microseconds>(wall).count();
+            long long second = micros / 1000000;
+            long long fraction = micros % 1000000;
+            if (fraction < 0)
+            {
+                --second;
+                fraction += 1000000;
+            }
+
+            if (second != cached_second)
+            {
+                cached_second = second;
+                std::tm tm_value{};
+                prefix_size = 0;
+                if (local_time(static_cast<std::time_t>(second), tm_value))
+                    prefix_size = std::strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &tm_value);
+            }
+
+            out.append(prefix, prefix_size);
+            char digits[7];
+            digits[0] = '.';
+            for (int i = 6; i >= 1; --i)
+            {
+                digits[i] = static_cast<char>('0' + fraction % 10);
+                fraction /= 10;
+            }
+            out.append(digits, sizeof(digits));
+        }
+
+    private:
+        std::chrono::system_clock::time_point anchor_wall;
+        std::chrono::steady_clock::time_point anchor_steady;
+        long long cached_second = -1;
+        char prefix[32];
+        size_t prefix_size = 0;
+    };
+
+    constexpr size_t kRingSlots = 1024; // power of two
+    constexpr size_t kMaxEventText = 480; // longer descriptions are cut short
+    constexpr auto kFlushInterval = std::chrono::milliseconds(100);
+
+    struct LogRecord
+    {
+        // Ring position this slot is ready for: == pos when free to write, == pos + 1 once written
+        std::atomic<size_t> sequence{0};
+        std::chrono::steady_clock::time_point time;
+        LogEventType type = LogEventType::Internal;
+        LogSeverity severity = LogSeverity::Info;
+        uint16_t size = 0;
+        char text[kMaxEventText];
+    };
+
+    // Bounded multi-producer / single-consumer ring (per-slot sequence numbers, no locks)
+    // Producers that find it full drop the event rather than wait
+    struct LogRing
+    {
+        LogRecord slots[kRingSlots];
+        alignas(64) std::atomic<size_t> write_pos{0};
+        alignas(64) std::atomic<size_t> read_pos{0}; // only moved by the background thread
+
+        LogRing()
+        {
+            for (size_t i = 0; i < kRingSlots; ++i)
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        bool push(std::string_view text, LogEventType type, LogSeverity severity, size_t& out_used)
+        {
+            size_t pos = write_pos.load(std::memory_order_relaxed);
+            LogRecord* slot = nullptr;
+            while (true)
+            {
+                slot = &slots[pos & (kRingSlots - 1)];
+                size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                if (sequence == pos)
+                {
+                    if (write_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (sequence < pos)
+                {
+                    return false; // full, the consumer hasn't freed this slot yet
+                }
+                else
+                {
+                    pos = write_pos.load(std::memory_order_relaxed);
+                }
+            }
+
+            slot->time = std::chrono::steady_clock::now();
+            slot->type = type;
+            slot->severity = severity;
+            slot->size = static_cast<uint16_t>(text.size() < kMaxEventText ? text.size() : kMaxEventText);
+            std::memcpy(slot->text, text.data(), slot->size);
+            slot->sequence.store(pos + 1, std::memory_order_release);
+
+            // Rough fill level, only used to decide whether to wake the writer early
+            size_t consumed = read_pos.load(std::memory_order_relaxed);
+            out_used = pos + 1 > consumed ? pos + 1 - consumed : 0;
+            return true;
+        }
+
+        // Consumer side, hands each written record to fn in order
+        template <typename Fn>
+        void drain(Fn&& fn)
+        {
+            size_t pos = read_pos.load(std::memory_order_relaxed);
+            while (true)
+            {
+                LogRecord& slot = slots[pos & (kRingSlots - 1)];
+                if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+                    break;
+
+                fn(slot);
+                slot.sequence.store(pos + kRingSlots, std::memory_order_release);
+                ++pos;
+            }
+            read_pos.store(pos, std::memory_order_relaxed);
+        }
+    };
+
+    constexpr size_t kMinSegmentBytes = 64 * 1024;
+
+    struct AsyncLogger
+    {
+        LogRing ring;
+        std::atomic<uint64_t> dropped{0};
+
+        // Background thread only, once started
+        std::string batch;
+        TimestampCache clock;
+        MappedFile segment;
+        size_t segment_used = 0;
+        size_t segment_index = 0;
+        std::string base_path; // directory + "/log-<start>"
+        std::deque<std::string> segment_paths; // oldest first
+        LogRotation rotation;
+
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+
+        ~AsyncLogger() { stop(); }
+
+        // Formats everything in the ring into one buffer, and writes it with a single call
+        void write_pending()
+        {
+            batch.clear();
+            clock.reanchor();
+            ring.drain([&](const LogRecord& record) {
+                batch += "[";
+                clock.append(record.time, batch);
+                batch += "] [";
+                batch += to_string(record.severity);
+                batch += "] [";
+                batch += to_string(record.type);
+                batch += "] ";
+                batch.append(record.text, record.size);
+                batch += "\n";
+            });
+
+            uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+            if (lost > 0)
+                batch += "[Logger] " + std::to_string(lost) + " events dropped, the log could not keep up\n";
+
+            append(batch);
+        }
+
+        std::string segment_path(size_t index) const
+        {
+            return index == 0 ? base_path + ".txt" : base_path + "." + std::to_string(index) + ".txt";
+        }
+
+        // Closes the current segment (trimmed to what was written) and maps the next one
+        bool open_segment(size_t index)
+        {
+            if (segment.is_open())
+                segment.close(segment_used);
+
+            std::string path = segment_path(index);
+            segment_used = 0;
+            segment_index = index;
+            if (!segment.create(path, rotation.segment_bytes))
+                return false;
+
+            segment_paths.push_back(path);
+            while (segment_paths.size() > rotation.segment_count)
+            {
+                std::error_code ec;
+                std::filesystem::remove(segment_paths.front(), ec);
+                segment_paths.pop_front();
+            }
+            return true;
+        }
+
+        // Copies text into the mapped segment(s), moving on to a new segment at line boundaries
+        void append(std::string_view text)
+        {
+            while (!text.empty() && segment.is_open())
+            {
+                size_t space = segment.size() - segment_used;
+                size_t take = text.size();
+                if (take > space)
+                {
+                    // Split after the last whole line that fits, a line never straddles two segments
+                    size_t cut = text.substr(0, space).rfind('\n');
+                    take = cut == std::string_view::npos ? 0 : cut + 1;
+                    if (take == 0 && segment_used == 0)
+                        take = space; // a single line bigger than a segment, nothing better to do
+                }
+
+                std::memcpy(segment.data() + segment_used, text.data(), take);
+                segment_used += take;
+                text.remove_prefix(take);
+
+                if (!text.empty() && !open_segment(segment_index + 1))
+                    return;
+            }
+        }
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stopping)
+            {
+                wake.wait_for(lock, kFlushInterval);
+                lock.unlock();
+                write_pending();
+                lock.lock();
+            }
+            lock.unlock();
+            write_pending();
+        }
+
+        void stop()
+        {
+            if (!worker.joinable())
+                return;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            worker.join();
+
+            segment.close(segment_used);
+            segment_paths.clear();
+        }
+    };
+
+    AsyncLogger logger;
+
+    // What setLogThreshold asked for, applied once the logger is running
+    std::atomic<int> requested_threshold{static_cast<int>(LogSeverity::Info)};
+    constexpr int kLoggingOff = static_cast<int>(LogSeverity::Error) + 1;
 }
 
-bool initialiseLogger(const std::string& directory, std::string& out_logfile)
+std::atomic<int> log_detail::threshold{kLoggingOff};
+
+std::string& log_detail::format_buffer()
+{
+    thread_local std::string buffer;
+    return buffer;
+}
+
+void setLogThreshold(LogSeverity severity)
+{
+    requested_threshold.store(static_cast<int>(severity), std::memory_order_relaxed);
+    if (logger.worker.joinable())
+        log_detail::threshold.store(static_cast<int>(severity), std::memory_order_relaxed);
+}
+
+bool initialiseLogger(const std::string& directory, std::string& out_logfile, const LogRotation& rotation)
 {
     // Gets a viable filepath for the log, stores into out_logfile
+    out_logfile = "";
+    if (logger.worker.joinable())
+        return false;
+
     std::error_code ec;
     std::filesystem::create_directories(directory, ec);
     if (ec)
-        out_logfile = "";
-    return false;
+        return false;
 
     // filename of log should be current datetime of initialisation
     std::string stamp;
     if (!format_current_time("%Y-%m-%d_%H-%M-%S", stamp))
-        out_logfile = "";
-    return false;
+        return false;
 
-    out_logfile = directory + "/log-" + stamp + ".txt";
+    logger.rotation = rotation;
+    if (logger.rotation.segment_bytes < kMinSegmentBytes)
+        logger.rotation.segment_bytes = kMinSegmentBytes;
+    if (logger.rotation.segment_count == 0)
+        logger.rotation.segment_count = 1;
 
-    std::ofstream out(out_logfile, std::ios::out | std::ios::trunc);
-    if (!out.is_open())
-        out_logfile = "";
-    return false;
+    logger.base_path = directory + "/log-" + stamp;
+    if (!logger.open_segment(0))
+        return false;
+    logger.append("Log started\n");
+
+    logger.stopping = false;
+    logger.worker = std::thread([] { logger.run(); });
+    log_detail::threshold.store(requested_threshold.load(std::memory_order_relaxed), std::memory_order_relaxed);
 
-    out << "Log started\n";
+    out_logfile = logger.segment_path(0);
     return true;
 }
 
@@ -105,19 +435,30 @@ bool logEvent(const std::string& logfile,
     // Write event to logfile
     if (logfile == "")
         return false;
+    return logMessage(event_description, event_type, severity);
+}
 
-    std::string stamp;
-    if (!format_current_time("%Y-%m-%d %H:%M:%S", stamp))
+bool logMessage(std::string_view event_description, LogEventType event_type, LogSeverity severity)
+{
+    if (!log_detail::enabled(severity))
         return false;
 
-    std::ofstream out(logfile, std::ios::out | std::ios::app);
-    if (!out.is_open())
+    size_t used = 0;
+    if (!logger.ring.push(event_description, event_type, severity, used))
+    {
+        logger.dropped.fetch_add(1, std::memory_order_relaxed);
         return false;
+    }
 
-    out << "[" << stamp << "] "
-        << "[" << to_string(severity) << "] "
-        << "[" << to_string(event_type) << "] "
-        << event_description << "\n";
-
+    // The writer wakes up on its own timer, it is only prodded when the ring is filling up
+    // (or something went wrong, so it reaches the file promptly)
+    if (used >= kRingSlots / 2 || severity == LogSeverity::Error)
+        logger.wake.notify_one();
     return true;
 }
+
+void shutdownLogger()
+{
+    log_detail::threshold.store(kLoggingOff, std::memory_order_relaxed);
+    logger.stop();
+}
@@ -0,0 +1,114 @@
+#include "headers/lsp-methods.h"
+
+#include <cstring>
+
+/*
+Method lookup
+
+Every incoming message carries its method as a string, and it has to be turned into something
+that can be switched on/indexed by. Rather than a chain of string compares, the method list is
+hashed into a table at compile time, with the hash seed picked (also at compile time) so that no
+two methods land in the same slot. A lookup is then one hash of the bytes, one table load and one
+memcmp to reject unknown methods that happen to land on a used slot.
+*/
+
+namespace
+{
+    constexpr std::string_view kNames[] = {
+#define LSP_METHOD_NAME(name, string, direction) string,
+        LSP_METHOD_LIST(LSP_METHOD_NAME)
+#undef LSP_METHOD_NAME
+    };
+
+    constexpr MethodDirection kDirections[] = {
+#define LSP_METHOD_DIRECTION(name, string, direction) MethodDirection::direction,
+        LSP_METHOD_LIST(LSP_METHOD_DIRECTION)
+#undef LSP_METHOD_DIRECTION
+    };
+
+    static_assert(sizeof(kNames) / sizeof(kNames[0]) == kLspMethodCount, "method table out of sync");
+
+    // Power of two, roughly 10x the method count so a collision-free seed is found within a few tries
+    constexpr size_t kTableSize = 1024;
+    constexpr uint8_t kEmptySlot = 0xFF;
+    static_assert(kLspMethodCount < kEmptySlot, "method ids have to fit a slot");
+
+    // FNV-1a, seeded, with a final avalanche so the low bits used for the slot are well mixed
+    constexpr uint32_t method_hash(std::string_view s, uint32_t seed)
+    {
+        uint32_t h = 2166136261U ^ seed;
+        for (char c : s)
+        {
+            h ^= static_cast<unsigned char>(c);
+            h *= 16777619U;
+        }
+        h ^= h >> 15;
+        h *= 0x2C1B3C6DU;
+        h ^= h >> 12;
+        return h;
+    }
+
+    struct MethodTable
+    {
+        uint32_t seed = 0;
+        uint8_t slots[kTableSize] = {};
+    };
+
+    // Tries seeds until every method gets its own slot
+    constexpr MethodTable build_table()
+    {
+        for (uint32_t seed = 1; seed < 4096; ++seed)
+        {
+            MethodTable table;
+            for (size_t s = 0; s < kTableSize; ++s)
+                table.slots[s] = kEmptySlot;
+
+            bool collision = false;
+            for (size_t m = 0; m < kLspMethodCount && !collision; ++m)
+            {
+                size_t slot = method_hash(kNames[m], seed) & (kTableSize - 1);
+                if (table.slots[slot] != kEmptySlot)
+                    collision = true;
+                else
+                    table.slots[slot] = static_cast<uint8_t>(m);
+            }
+
+            if (!collision)
+            {
+                table.seed = seed;
+                return table;
+            }
+        }
+        return MethodTable{};
+    }
+
+    constexpr MethodTable kTable = build_table();
+    static_assert(kTable.seed != 0, "no perfect hash seed found, grow kTableSize");
+}
+
+LspMethod lookupMethod(std::string_view name)
+{
+    uint8_t slot = kTable.slots[method_hash(name, kTable.seed) & (kTableSize - 1)];
+    if (slot == kEmptySlot)
+        return LspMethod::Unknown;
+
+    std::string_view candidate = kNames[slot];
+    if (candidate.size() != name.size() || std::memcmp(candidate.data(), name.data(), name.size()) != 0)
+        return LspMethod::Unknown;
+
+    return static_cast<LspMethod>(slot);
+}
+
+std::string_view methodName(LspMethod method)
+{
+    if (method == LspMethod::Unknown)
+        return {};
+    return kNames[static_cast<size_t>(method)];
+}
+
+MethodDirection methodDirection(LspMethod method)
+{
+    if (method == LspMethod::Unknown)
+        return MethodDirection::Both;
+    return kDirections[static_cast<size_t>(method)];
+}
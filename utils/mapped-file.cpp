@@ -0,0 +1,124 @@
+#include "headers/mapped-file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool MappedFile::create(const std::string &path, size_t capacity)
+{
+    close();
+
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                                CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    // Mapping a size bigger than the file extends it, which is the preallocation
+    ULARGE_INTEGER size;
+    size.QuadPart = capacity;
+    HANDLE map = CreateFileMappingA(handle, nullptr, PAGE_READWRITE, size.HighPart, size.LowPart, nullptr);
+    void *view = map != nullptr ? MapViewOfFile(map, FILE_MAP_WRITE, 0, 0, capacity) : nullptr;
+    if (view == nullptr)
+    {
+        if (map != nullptr)
+            CloseHandle(map);
+        CloseHandle(handle);
+        return false;
+    }
+
+    file = handle;
+    mapping = map;
+    mapped = static_cast<char *>(view);
+    mapped_size = capacity;
+    return true;
+}
+
+void MappedFile::close(size_t used)
+{
+    if (mapped == nullptr)
+        return;
+
+    UnmapViewOfFile(mapped);
+    CloseHandle(mapping);
+
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(used < mapped_size ? used : mapped_size);
+    SetFilePointerEx(file, end, nullptr, FILE_BEGIN);
+    SetEndOfFile(file);
+    CloseHandle(file);
+
+    mapped = nullptr;
+    mapping = nullptr;
+    file = nullptr;
+    mapped_size = 0;
+}
+
+void MappedFile::sync()
+{
+    if (mapped == nullptr)
+        return;
+    FlushViewOfFile(mapped, mapped_size);
+    FlushFileBuffers(file);
+}
+
+#else
+
+bool MappedFile::create(const std::string &path, size_t capacity)
+{
+    close();
+
+    int handle = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (handle < 0)
+        return false;
+
+    // Reserve the blocks up front, a sparse file would fault in (and could fail to find) space mid-append
+#ifdef __linux__
+    bool sized = posix_fallocate(handle, 0, static_cast<off_t>(capacity)) == 0;
+#else
+    bool sized = ftruncate(handle, static_cast<off_t>(capacity)) == 0;
+#endif
+
+    void *view = sized ? mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0) : MAP_FAILED;
+    if (view == MAP_FAILED)
+    {
+        ::close(handle);
+        return false;
+    }
+
+    fd = handle;
+    mapped = static_cast<char *>(view);
+    mapped_size = capacity;
+    return true;
+}
+
+void MappedFile::close(size_t used)
+{
+    if (mapped == nullptr)
+        return;
+
+    munmap(mapped, mapped_size);
+
+    // If this fails the unused tail is just left as zeroes, which readers stop at anyway
+    int trimmed = ftruncate(fd, static_cast<off_t>(used < mapped_size ? used : mapped_size));
+    (void)trimmed;
+    ::close(fd);
+
+    mapped = nullptr;
+    mapped_size = 0;
+    fd = -1;
+}
+
+void MappedFile::sync()
+{
+    if (mapped != nullptr)
+        msync(mapped, mapped_size, MS_SYNC);
+}
+
+#endif
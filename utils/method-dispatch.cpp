@@ -0,0 +1,284 @@
+#include "headers/method-dispatch.h"
+#include "headers/lsp-types.h"
+#include "headers/trace-log.h"
+
+void registerHandler(Dispatcher &dispatcher, LspMethod method, MethodHandler handler)
+{
+    if (method == LspMethod::Unknown)
+        return;
+    dispatcher.handlers[static_cast<size_t>(method)] = handler;
+}
+
+void registerResponseHandler(Dispatcher &dispatcher, ResponseHandler handler)
+{
+    dispatcher.on_response = handler;
+}
+
+void writeErrorResponse(std::string &body, const RequestId &id, ErrorCode code, std::string_view message)
+{
+    writeErrorResponse(body, &id, code, message);
+}
+
+void writeErrorResponse(std::string &body, const RequestId *id, ErrorCode code, std::string_view message)
+{
+    body.clear();
+    JsonWriter json(body);
+    beginResponseBody(json, id, "error");
+    json.begin_object();
+    json.key("code");
+    json.value(static_cast<int>(code));
+    json.key("message");
+    json.string(message);
+    json.end_object();
+    endResponseBody(json);
+}
+
+Execution executionPolicy(LspMethod method)
+{
+    switch (method)
+    {
+    case LspMethod::Declaration:
+    case LspMethod::Definition:
+    case LspMethod::TypeDefinition:
+    case LspMethod::Implementation:
+    case LspMethod::References:
+    case LspMethod::PrepareCallHierarchy:
+    case LspMethod::CallHierarchyIncomingCalls:
+    case LspMethod::CallHierarchyOutgoingCalls:
+    case LspMethod::PrepareTypeHierarchy:
+    case LspMethod::TypeHierarchySupertypes:
+    case LspMethod::TypeHierarchySubtypes:
+    case LspMethod::DocumentHighlight:
+    case LspMethod::DocumentLink:
+    case LspMethod::DocumentLinkResolve:
+    case LspMethod::Hover:
+    case LspMethod::CodeLens:
+    case LspMethod::CodeLensResolve:
+    case LspMethod::FoldingRange:
+    case LspMethod::SelectionRange:
+    case LspMethod::DocumentSymbol:
+    case LspMethod::SemanticTokensFull:
+    case LspMethod::SemanticTokensFullDelta:
+    case LspMethod::SemanticTokensRange:
+    case LspMethod::InlayHint:
+    case LspMethod::InlayHintResolve:
+    case LspMethod::InlineValue:
+    case LspMethod::Moniker:
+    case LspMethod::Completion:
+    case LspMethod::CompletionItemResolve:
+    case LspMethod::DocumentDiagnostic:
+    case LspMethod::WorkspaceDiagnostic:
+    case LspMethod::SignatureHelp:
+    case LspMethod::DocumentColor:
+    case LspMethod::ColorPresentation:
+    case LspMethod::PrepareRename:
+    case LspMethod::LinkedEditingRange:
+    case LspMethod::WorkspaceSymbol:
+    case LspMethod::WorkspaceSymbolResolve:
+        return Execution::Concurrent;
+    default:
+        return Execution::Serial;
+    }
+}
+
+PriorityLane requestLane(LspMethod method)
+{
+    switch (method)
+    {
+    case LspMethod::Completion:
+    case LspMethod::CompletionItemResolve:
+    case LspMethod::Hover:
+    case LspMethod::SignatureHelp:
+    case LspMethod::DocumentHighlight:
+    case LspMethod::LinkedEditingRange:
+    case LspMethod::PrepareRename:
+    case LspMethod::SelectionRange:
+        return PriorityLane::Interactive;
+    case LspMethod::DocumentDiagnostic:
+    case LspMethod::WorkspaceDiagnostic:
+    case LspMethod::SemanticTokensFull:
+    case LspMethod::SemanticTokensFullDelta:
+    case LspMethod::SemanticTokensRange:
+    case LspMethod::InlayHint:
+    case LspMethod::InlineValue:
+    case LspMethod::CodeLens:
+    case LspMethod::FoldingRange:
+    case LspMethod::DocumentLink:
+    case LspMethod::DocumentColor:
+        return PriorityLane::Background;
+    default:
+        return PriorityLane::Normal;
+    }
+}
+
+namespace
+{
+    // Per thread response buffers, the sequencer swaps a pooled packet buffer back in each time,
+    // so answering a request doesn't allocate once things have warmed up
+    std::string &response_body()
+    {
+        thread_local std::string body;
+        return body;
+    }
+
+    JsonWriter &response_writer()
+    {
+        thread_local JsonWriter json;
+        return json;
+    }
+
+    // Runs a request's handler, leaving its whole response (result or error) in body
+    void run_request(MethodHandler handler, const Message &msg, ServerState &state, CancellationToken cancel,
+                     std::string &body)
+    {
+        // Cancelled while it was still queued, it never starts
+        if (cancel.cancelled())
+        {
+            writeErrorResponse(body, *msg.id, ErrorCode::RequestCancelled, "Request cancelled");
+            return;
+        }
+
+        ParamsView params(msg.params_json.value_or(std::string_view()));
+
+        body.clear();
+        JsonWriter &json = response_writer();
+        json.reset(body);
+        beginResponseBody(json, *msg.id, "result");
+
+        RequestContext ctx(msg, params, state, json);
+        ctx.cancel = cancel;
+        if (handler(ctx))
+        {
+            endResponseBody(json);
+            return;
+        }
+
+        // Whatever the handler wrote is dropped
+        if (ctx.cancelled())
+            writeErrorResponse(body, *msg.id, ErrorCode::RequestCancelled, "Request cancelled");
+        else
+            writeErrorResponse(body, *msg.id, ctx.error_code, ctx.error_message);
+    }
+
+    // Records msg as handled (response_size is 0 for notifications), on whichever thread handled it
+    void trace_handled(const Message &msg, size_t response_size)
+    {
+        traceEvent(TracePhase::Dispatch, msg.method_id, msg.id.has_value() ? &*msg.id : nullptr, response_size);
+    }
+
+    void answer(ResponseSequencer &responses, uint64_t ticket, const Message &msg, std::string &body)
+    {
+        trace_handled(msg, body.size());
+        responses.complete(ticket, body);
+    }
+
+    void answer_error(ResponseSequencer &responses, const Message &msg, ErrorCode code, std::string_view message)
+    {
+        uint64_t ticket = responses.reserve(true);
+        std::string &body = response_body();
+        writeErrorResponse(body, *msg.id, code, message);
+        answer(responses, ticket, msg, body);
+    }
+}
+
+void dispatchMessage(const Dispatcher &dispatcher, ServerState &state, Message &&msg, ResponseSequencer &responses,
+                     RequestExecutor *executor)
+{
+    // Responses to server -> client requests, handed to whoever sent the request
+    if (!msg.method.has_value())
+    {
+        if (msg.id.has_value() && dispatcher.on_response != nullptr)
+            dispatcher.on_response(msg);
+        trace_handled(msg, 0);
+        return;
+    }
+
+    const bool is_request = msg.id.has_value();
+    const LspMethod method = msg.method_id;
+
+    // Before initialize only initialize (and exit) get through
+    if (!state.initialized && method != LspMethod::Initialize && method != LspMethod::Exit)
+    {
+        if (is_request)
+            answer_error(responses, msg, ErrorCode::ServerNotInitialized, "Server has not been initialized");
+        else
+            trace_handled(msg, 0);
+        return;
+    }
+
+    if (state.shutdown && method != LspMethod::Exit)
+    {
+        if (is_request)
+            answer_error(responses, msg, ErrorCode::InvalidRequest, "Server is shutting down");
+        else
+            trace_handled(msg, 0);
+        return;
+    }
+
+    // Needs the in-flight table rather than a handler. Requests run inline (no executor) are
+    // answered before the next message is read, so there is never anything to cancel
+    if (method == LspMethod::CancelRequest)
+    {
+        CancelParams params;
+        if (executor != nullptr && msg.params_json.has_value() && decodeParams(*msg.params_json, params))
+            executor->in_flight().cancel(params.id);
+        trace_handled(msg, 0);
+        return;
+    }
+
+    MethodHandler handler = method == LspMethod::Unknown ? nullptr : dispatcher.handlers[static_cast<size_t>(method)];
+    if (handler == nullptr)
+    {
+        // Unknown notifications (including optional "$/" ones) are ignored
+        if (is_request)
+            answer_error(responses, msg, ErrorCode::MethodNotFound, "Method not found: " + *msg.method);
+        else
+            trace_handled(msg, 0);
+        return;
+    }
+
+    if (!is_request)
+    {
+        // Nothing is sent back, anything written goes into a throwaway buffer
+        ParamsView params(msg.params_json.value_or(std::string_view()));
+        std::string unused;
+        JsonWriter result(unused);
+        RequestContext ctx(msg, params, state, result);
+        handler(ctx);
+        trace_handled(msg, 0);
+        return;
+    }
+
+    const bool concurrent = executionPolicy(method) == Execution::Concurrent;
+    uint64_t ticket = responses.reserve(!concurrent);
+
+    if (concurrent && executor != nullptr)
+    {
+        // The body is reused by the next read, so the worker gets its own copy of params
+        keepParams(msg);
+        InFlightTable &in_flight = executor->in_flight();
+        size_t slot = in_flight.insert(*msg.id);
+        auto task = [handler, ticket, slot, snapshot = state, request = std::move(msg), &responses, &in_flight]() mutable {
+            std::string &body = response_body();
+            run_request(handler, request, snapshot, in_flight.token(slot), body);
+            answer(responses, ticket, request, body);
+            in_flight.release(slot);
+            // The main thread may already be blocked reading, so nothing else would send it
+            responses.flush();
+        };
+        executor->submit(requestLane(method), std::move(task));
+        return;
+    }
+
+    std::string &body = response_body();
+    run_request(handler, msg, state, CancellationToken(), body);
+    answer(responses, ticket, msg, body);
+}
+
+void rejectMessage(ResponseSequencer &responses, ErrorCode code, std::string_view message)
+{
+    uint64_t ticket = responses.reserve(true);
+    std::string &body = response_body();
+    writeErrorResponse(body, nullptr, code, message);
+    responses.complete(ticket, body);
+}
@@ -0,0 +1,204 @@
+#include "headers/packet-writer.h"
+
+#include <utility>
+
+// Outgoing packets are batched here, so a response and any notifications produced
+// alongside it leave in one writev instead of a syscall (and a header copy) each
+
+namespace
+{
+    // Bodies bigger than this are not kept around once written (e.g. a one-off full document)
+    constexpr size_t kMaxPooledBody = 1024 * 1024;
+
+    // {"jsonrpc":"2.0" -- every packet starts the same way
+    void begin_envelope(JsonWriter &json)
+    {
+        json.begin_object();
+        json.key("jsonrpc");
+        json.string("2.0");
+    }
+}
+
+PacketWriter::Packet &PacketWriter::acquire()
+{
+    if (queued == packets.size())
+        packets.emplace_back();
+    return packets[queued];
+}
+
+// Queues an already encoded body
+// Swapped rather than copied, both buffers keep their capacity for the next packet
+bool PacketWriter::queue_body(std::string &body)
+{
+    Packet &packet = acquire();
+    packet.header_size = writeLspHeader(body.size(), packet.header, sizeof(packet.header));
+    if (packet.header_size == 0)
+        return false;
+
+    packet.body.swap(body);
+    body.clear();
+    ++queued;
+    return true;
+}
+
+bool PacketWriter::enqueue(const Message &msg)
+{
+    Packet &packet = acquire();
+    if (!serialiseMessage(msg, packet.body))
+        return false;
+
+    packet.header_size = writeLspHeader(packet.body.size(), packet.header, sizeof(packet.header));
+    if (packet.header_size == 0)
+        return false;
+
+    ++queued;
+    return true;
+}
+
+void beginResponseBody(JsonWriter &json, const RequestId &id, std::string_view member)
+{
+    beginResponseBody(json, &id, member);
+}
+
+void beginResponseBody(JsonWriter &json, const RequestId *id, std::string_view member)
+{
+    begin_envelope(json);
+    json.key("id");
+    if (id == nullptr)
+        json.null();
+    else if (id->is_string())
+        json.string(id->text());
+    else
+        json.value(id->number());
+    json.key(member);
+}
+
+void endResponseBody(JsonWriter &json)
+{
+    if (json.awaiting_value())
+        json.null();
+    json.end_object();
+}
+
+bool PacketWriter::enqueue_response(std::string &body)
+{
+    if (batching)
+    {
+        batch_body.push_back(batch_responses++ == 0 ? '[' : ',');
+        batch_body += body;
+        body.clear();
+        return true;
+    }
+    return queue_body(body);
+}
+
+JsonWriter &PacketWriter::begin_notification(std::string_view method)
+{
+    open_body.clear();
+    open_writer.reset(open_body);
+    open = true;
+
+    JsonWriter &json = open_writer;
+    begin_envelope(json);
+    json.key("method");
+    json.string(method);
+    json.key("params");
+    return json;
+}
+
+JsonWriter &PacketWriter::begin_request(const RequestId &id, std::string_view method)
+{
+    open_body.clear();
+    open_writer.reset(open_body);
+    open = true;
+
+    JsonWriter &json = open_writer;
+    begin_envelope(json);
+    json.key("id");
+    if (id.is_string())
+        json.string(id.text());
+    else
+        json.value(id.number());
+    json.key("method");
+    json.string(method);
+    json.key("params");
+    return json;
+}
+
+bool PacketWriter::commit()
+{
+    if (!open)
+        return false;
+    open = false;
+
+    if (open_writer.awaiting_value())
+        open_writer.null();
+    open_writer.end_object();
+    return queue_body(open_body);
+}
+
+void PacketWriter::discard()
+{
+    open = false;
+    open_body.clear();
+}
+
+void PacketWriter::begin_batch()
+{
+    batching = true;
+    batch_body.clear();
+    batch_responses = 0;
+}
+
+bool PacketWriter::end_batch()
+{
+    batching = false;
+    if (batch_responses == 0)
+        return true;
+
+    batch_body.push_back(']');
+    batch_responses = 0;
+    return queue_body(batch_body);
+}
+
+void PacketWriter::hand_over(PacketWriter &to)
+{
+    packets.swap(to.packets);
+    queued = std::exchange(to.queued, queued);
+}
+
+size_t PacketWriter::pending_bytes() const
+{
+    size_t total = 0;
+    for (size_t i = 0; i < queued; ++i)
+        total += packets[i].header_size + packets[i].body.size();
+    return total;
+}
+
+bool PacketWriter::flush(Transport &out)
+{
+    if (queued == 0)
+        return true;
+
+    segments.clear();
+    for (size_t i = 0; i < queued; ++i)
+    {
+        segments.emplace_back(packets[i].header, packets[i].header_size);
+        segments.emplace_back(packets[i].body);
+    }
+
+    bool ok = out.write_segments(segments.data(), segments.size());
+
+    // Return the slots to the pool
+    for (size_t i = 0; i < queued; ++i)
+    {
+        if (packets[i].body.capacity() > kMaxPooledBody)
+            std::string().swap(packets[i].body);
+    }
+    if (!open && open_body.capacity() > kMaxPooledBody)
+        std::string().swap(open_body);
+    if (!batching && batch_body.capacity() > kMaxPooledBody)
+        std::string().swap(batch_body);
+    queued = 0;
+    return ok;
+}
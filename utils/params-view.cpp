@@ -0,0 +1,279 @@
+#include "headers/params-view.h"
+#include "headers/JSON-scan.h"
+
+#include <cstring>
+
+// Most handlers only need two or three fields out of params (textDocument.uri, position, ...),
+// so instead of decoding all of it they can resolve just those paths against the raw JSON
+
+namespace
+{
+    // Start of the params value, found without scanning the document
+    size_t root_start(std::string_view s)
+    {
+        size_t i = 0;
+        json_scan::skip_ws(s, i);
+        return i;
+    }
+
+    // Undoes the JSON pointer escapes ("~1" -> '/', "~0" -> '~')
+    bool unescape_token(std::string_view token, std::string &out)
+    {
+        out.clear();
+        for (size_t i = 0; i < token.size(); ++i)
+        {
+            if (token[i] != '~')
+            {
+                out.push_back(token[i]);
+                continue;
+            }
+            if (i + 1 >= token.size() || (token[i + 1] != '0' && token[i + 1] != '1'))
+                return false;
+            out.push_back(token[i + 1] == '0' ? '~' : '/');
+            ++i;
+        }
+        return true;
+    }
+
+    // Moves `at` from the start of an object to the start of member `name`'s value
+    // The whole object is walked, so a duplicated name resolves to its last value, like storeMessage
+    bool step_object(std::string_view s, size_t &at, std::string_view name)
+    {
+        size_t i = at + 1;
+        json_scan::skip_ws(s, i);
+        if (i < s.size() && s[i] == '}')
+            return false;
+
+        std::string decoded;
+        size_t found = std::string_view::npos;
+        while (i < s.size())
+        {
+            size_t key_start = i;
+            bool escaped = false;
+            if (!json_scan::scan_string(s, i, escaped))
+                return false;
+
+            std::string_view key = s.substr(key_start + 1, i - key_start - 2);
+            bool match = false;
+            if (!escaped)
+                match = key == name;
+            else if (json_scan::decode_string(key, decoded))
+                match = decoded == name;
+
+            json_scan::skip_ws(s, i);
+            if (i >= s.size() || s[i] != ':')
+                return false;
+            ++i;
+
+            json_scan::skip_ws(s, i);
+
+            // Later duplicates win, same as storeMessage does for the envelope
+            if (match)
+                found = i;
+
+            if (!json_scan::skip_value(s, i))
+                return false;
+
+            json_scan::skip_ws(s, i);
+            if (i < s.size() && s[i] == '}')
+                break;
+            if (i >= s.size() || s[i] != ',')
+                return false;
+            ++i;
+            json_scan::skip_ws(s, i);
+        }
+
+        if (found == std::string_view::npos)
+            return false;
+        at = found;
+        return true;
+    }
+
+    // Moves `at` from the start of an array to the start of element `index`
+    bool step_array(std::string_view s, size_t &at, std::string_view index_token)
+    {
+        // Array indices are plain decimals without leading zeros
+        if (index_token.empty() || (index_token.size() > 1 && index_token[0] == '0'))
+            return false;
+
+        size_t index = 0;
+        for (char c : index_token)
+        {
+            if (c < '0' || c > '9' || index > (SIZE_MAX - 9) / 10)
+                return false;
+            index = index * 10 + static_cast<size_t>(c - '0');
+        }
+
+        size_t i = at + 1;
+        json_scan::skip_ws(s, i);
+        if (i < s.size() && s[i] == ']')
+            return false;
+
+        for (size_t e = 0; i < s.size(); ++e)
+        {
+            json_scan::skip_ws(s, i);
+            if (e == index)
+            {
+                at = i;
+                return true;
+            }
+
+            if (!json_scan::skip_value(s, i))
+                return false;
+
+            json_scan::skip_ws(s, i);
+            if (i >= s.size() || s[i] != ',')
+                return false;
+            ++i;
+        }
+        return false;
+    }
+
+    // True if raw is exactly one number token
+    bool is_number(std::string_view raw)
+    {
+        size_t i = 0;
+        return json_scan::scan_number(raw, i) && i == raw.size();
+    }
+}
+
+ParamsView::ParamsView(std::string_view params_json)
+    : source(params_json)
+{
+}
+
+bool ParamsView::cache_lookup(std::string_view path, size_t &begin) const
+{
+    for (size_t c = 0; c < cache_used; ++c)
+    {
+        const CacheEntry &entry = cache[c];
+        if (entry.path_size == path.size() && std::memcmp(entry.path, path.data(), path.size()) == 0)
+        {
+            begin = entry.begin;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ParamsView::cache_store(std::string_view path, size_t begin)
+{
+    if (path.empty() || path.size() > kMaxCachedPath)
+        return;
+
+    size_t slot = cache_used < kCacheSize ? cache_used++ : cache_next++ % kCacheSize;
+    CacheEntry &entry = cache[slot];
+    std::memcpy(entry.path, path.data(), path.size());
+    entry.path_size = static_cast<uint8_t>(path.size());
+    entry.begin = static_cast<uint32_t>(begin);
+}
+
+bool ParamsView::find(std::string_view pointer, std::string_view &out_raw)
+{
+    if (!pointer.empty() && pointer[0] != '/')
+        return false;
+
+    // Start from the longest prefix that has already been resolved
+    size_t at = 0;
+    size_t resolved = pointer.size();
+    while (!cache_lookup(pointer.substr(0, resolved), at))
+    {
+        if (resolved == 0)
+        {
+            at = root_start(source);
+            break;
+        }
+        resolved = pointer.rfind('/', resolved - 1);
+    }
+
+    std::string unescaped;
+    while (resolved < pointer.size())
+    {
+        // Next reference token, between this '/' and the next
+        size_t token_start = resolved + 1;
+        size_t token_end = pointer.find('/', token_start);
+        if (token_end == std::string_view::npos)
+            token_end = pointer.size();
+        std::string_view token = pointer.substr(token_start, token_end - token_start);
+
+        if (token.find('~') != std::string_view::npos)
+        {
+            if (!unescape_token(token, unescaped))
+                return false;
+            token = unescaped;
+        }
+
+        bool found = false;
+        if (at < source.size() && source[at] == '{')
+            found = step_object(source, at, token);
+        else if (at < source.size() && source[at] == '[')
+            found = step_array(source, at, token);
+        if (!found)
+            return false;
+
+        resolved = token_end;
+        cache_store(pointer.substr(0, resolved), at);
+    }
+
+    // Only the target itself is measured
+    size_t end = at;
+    if (!json_scan::skip_value(source, end))
+        return false;
+
+    out_raw = source.substr(at, end - at);
+    return true;
+}
+
+bool ParamsView::has(std::string_view pointer)
+{
+    std::string_view raw;
+    return find(pointer, raw);
+}
+
+bool ParamsView::get_string(std::string_view pointer, std::string &out)
+{
+    std::string_view raw;
+    if (!find(pointer, raw) || raw.empty() || raw[0] != '"')
+        return false;
+    return json_scan::decode_string(raw.substr(1, raw.size() - 2), out);
+}
+
+bool ParamsView::get_int(std::string_view pointer, long long &out)
+{
+    std::string_view raw;
+    if (!find(pointer, raw) || !is_number(raw))
+        return false;
+
+    // Whole numbers only, "1e2" is fine but "1.5" is not
+    return json_scan::to_integer(raw, out);
+}
+
+bool ParamsView::get_double(std::string_view pointer, double &out)
+{
+    std::string_view raw;
+    if (!find(pointer, raw) || !is_number(raw))
+        return false;
+
+    return json_scan::to_double(raw, out);
+}
+
+bool ParamsView::get_bool(std::string_view pointer, bool &out)
+{
+    std::string_view raw;
+    if (!find(pointer, raw))
+        return false;
+
+    if (raw == "true")
+        out = true;
+    else if (raw == "false")
+        out = false;
+    else
+        return false;
+    return true;
+}
+
+bool ParamsView::is_null(std::string_view pointer)
+{
+    std::string_view raw;
+    return find(pointer, raw) && raw == "null";
+}
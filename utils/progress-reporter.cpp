@@ -0,0 +1,378 @@
+#include "headers/progress-reporter.h"
+#include "headers/lsp-methods.h"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr uint32_t kPartScale = 10000; // a part's progress is kept in hundredths of a percent
+
+    void write_token(JsonWriter &json, const ProgressToken &token)
+    {
+        if (token.is_string())
+            json.string(token.text());
+        else
+            json.value(token.number());
+    }
+}
+
+ProgressTask::ProgressTask(ProgressReporter &owner, std::string title, size_t parts, bool cancellable)
+    : owner(owner), title(std::move(title)), cancellable(cancellable), part_count(std::max<size_t>(parts, 1)),
+      parts(new std::atomic<uint32_t>[part_count])
+{
+    for (size_t i = 0; i < part_count; ++i)
+        this->parts[i].store(0, std::memory_order_relaxed);
+}
+
+void ProgressTask::update(size_t part, double fraction)
+{
+    if (part >= part_count)
+        return;
+
+    // Not fraction < 0 etc., so a NaN ends up as 0
+    if (!(fraction > 0.0))
+        fraction = 0.0;
+    else if (fraction > 1.0)
+        fraction = 1.0;
+    parts[part].store(static_cast<uint32_t>(fraction * kPartScale), std::memory_order_relaxed);
+}
+
+void ProgressTask::set_message(std::string_view text)
+{
+    std::lock_guard<std::mutex> lock(text_mutex);
+    message.assign(text);
+    message_changed = true;
+}
+
+void ProgressTask::finish(std::string_view text)
+{
+    {
+        std::lock_guard<std::mutex> lock(text_mutex);
+        end_message.assign(text);
+    }
+    if (!finished.exchange(true, std::memory_order_acq_rel))
+        owner.finished();
+}
+
+uint32_t ProgressTask::percentage() const
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < part_count; ++i)
+        total += parts[i].load(std::memory_order_relaxed);
+    return static_cast<uint32_t>(total / part_count * 100 / kPartScale);
+}
+
+ProgressReporter::ProgressReporter(ResponseSequencer &responses, std::chrono::milliseconds interval)
+    : responses(responses), interval(interval)
+{
+}
+
+ProgressReporter::~ProgressReporter()
+{
+    stop();
+}
+
+void ProgressReporter::set_client_support(bool supported)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    client_support = supported;
+}
+
+std::shared_ptr<ProgressTask> ProgressReporter::begin(std::string_view title, const std::optional<ProgressToken> &token,
+                                                      size_t parts, bool cancellable)
+{
+    auto task = std::make_shared<ProgressTask>(*this, std::string(title), parts, cancellable);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping)
+            return task;
+
+        if (token.has_value())
+        {
+            // The client made this one, it can be used straight away
+            task->token = *token;
+            task->state = ProgressTask::State::Ready;
+        }
+        else if (client_support)
+        {
+            task->token.assign("progress-" + std::to_string(next_token++));
+            task->state = ProgressTask::State::Create;
+        }
+        else
+        {
+            return task;
+        }
+
+        tasks.push_back(task);
+        if (!ticker.joinable())
+            ticker = std::thread([this] { ticker_loop(); });
+    }
+    wake.notify_one();
+    return task;
+}
+
+bool ProgressReporter::handle_response(const Message &msg)
+{
+    if (!msg.id.has_value())
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = std::find_if(creating.begin(), creating.end(),
+                                  [&](const auto &entry) { return entry.first == *msg.id; });
+        if (found == creating.end())
+            return false;
+
+        // An error means the client won't show it, the job still runs and finishes as normal
+        found->second->state = msg.error.has_value() ? ProgressTask::State::Disabled : ProgressTask::State::Ready;
+        creating.erase(found);
+    }
+    wake.notify_one();
+    return true;
+}
+
+void ProgressReporter::cancel(const ProgressToken &token)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::shared_ptr<ProgressTask> &task : tasks)
+    {
+        if (task->cancellable && task->token == token)
+            task->cancel_flag.store(true, std::memory_order_relaxed);
+    }
+}
+
+void ProgressReporter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (ticker.joinable())
+        ticker.join();
+
+    // Whatever the client is showing gets its end, or its progress UI would stay open
+    // Nothing else sends any more, so this is done here, with the ticker gone
+    std::vector<std::shared_ptr<ProgressTask>> begun;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::shared_ptr<ProgressTask> &task : tasks)
+        {
+            if (task->state == ProgressTask::State::Active)
+                begun.push_back(std::move(task));
+        }
+        tasks.clear();
+        creating.clear();
+    }
+    if (begun.empty())
+        return;
+
+    Send end;
+    end.kind = Send::Kind::End;
+    for (std::shared_ptr<ProgressTask> &task : begun)
+    {
+        end.task = std::move(task);
+        send(end);
+    }
+    responses.flush();
+}
+
+void ProgressReporter::finished()
+{
+    // Taken and dropped so the ticker is either before its check of the flag, or already waiting
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    wake.notify_one();
+}
+
+// Works out what each task needs sent, sends it with the lock dropped, and sleeps until
+// the next report is allowed (or something is begun, accepted or finished)
+void ProgressReporter::ticker_loop()
+{
+    std::vector<Send> sends;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping)
+    {
+        Clock::time_point now = Clock::now();
+        Clock::time_point next = Clock::time_point::max();
+
+        for (size_t i = 0; i < tasks.size();)
+        {
+            const std::shared_ptr<ProgressTask> &task = tasks[i];
+            const bool finished = task->finished.load(std::memory_order_acquire);
+
+            switch (task->state)
+            {
+            case ProgressTask::State::Create:
+            {
+                Send &create = sends.emplace_back();
+                create.kind = Send::Kind::Create;
+                create.task = task;
+                create.request = RequestId(next_request++);
+                creating.emplace_back(create.request, task);
+                task->state = ProgressTask::State::Creating;
+                break;
+            }
+            case ProgressTask::State::Creating:
+            {
+                // Nothing was shown yet, so nothing needs ending. Dropped here rather than waiting
+                // on a client that may never answer, a late answer is then just ignored
+                if (finished)
+                {
+                    creating.erase(std::find_if(creating.begin(), creating.end(),
+                                                [&](const auto &entry) { return entry.second == task; }));
+                    task->state = ProgressTask::State::Disabled;
+                }
+                break;
+            }
+            case ProgressTask::State::Ready:
+            {
+                // Begin always starts at 0, whatever was done while the token was being negotiated
+                // is picked up by the first report
+                Send &begin = sends.emplace_back();
+                begin.kind = Send::Kind::Begin;
+                begin.task = task;
+                task->state = ProgressTask::State::Active;
+                task->last_sent = now;
+                if (!finished)
+                    next = std::min(next, now + interval);
+                break;
+            }
+            case ProgressTask::State::Active:
+            {
+                if (finished || task->cancelled())
+                    break;
+
+                Clock::time_point allowed = task->last_sent + interval;
+                if (allowed > now)
+                {
+                    next = std::min(next, allowed);
+                    break;
+                }
+
+                Send report;
+                report.percentage = std::max(task->percentage(), task->reported);
+                {
+                    std::lock_guard<std::mutex> text(task->text_mutex);
+                    if (task->message_changed)
+                    {
+                        report.message = task->message;
+                        task->message_changed = false;
+                    }
+                }
+                if (report.percentage != task->reported || report.message.has_value())
+                {
+                    report.kind = Send::Kind::Report;
+                    report.task = task;
+                    task->reported = report.percentage;
+                    task->last_sent = now;
+                    sends.push_back(std::move(report));
+                }
+                // Looked at again next interval, whether or not anything changed, updates don't wake the ticker
+                next = std::min(next, now + interval);
+                break;
+            }
+            case ProgressTask::State::Disabled:
+                break;
+            }
+
+            // Finished tasks go once they are begun (end follows begin) or will never be shown
+            if (finished && (task->state == ProgressTask::State::Active || task->state == ProgressTask::State::Disabled))
+            {
+                if (task->state == ProgressTask::State::Active)
+                {
+                    Send &end = sends.emplace_back();
+                    end.kind = Send::Kind::End;
+                    end.task = task;
+                }
+                tasks.erase(tasks.begin() + static_cast<std::ptrdiff_t>(i));
+                continue;
+            }
+            ++i;
+        }
+
+        if (!sends.empty())
+        {
+            lock.unlock();
+            for (const Send &packet : sends)
+                send(packet);
+            sends.clear();
+
+            // Could block if the client isn't reading, the lock is dropped so tasks can still be begun and finished
+            responses.flush();
+            lock.lock();
+            continue;
+        }
+
+        if (next == Clock::time_point::max())
+            wake.wait(lock);
+        else
+            wake.wait_until(lock, next);
+    }
+}
+
+void ProgressReporter::send(const Send &packet)
+{
+    ProgressTask &task = *packet.task;
+
+    if (packet.kind == Send::Kind::Create)
+    {
+        responses.request(packet.request, methodName(LspMethod::WorkDoneProgressCreate), [&](JsonWriter &params) {
+            params.begin_object();
+            params.key("token");
+            write_token(params, task.token);
+            params.end_object();
+        });
+        return;
+    }
+
+    std::string end_message;
+    if (packet.kind == Send::Kind::End)
+    {
+        std::lock_guard<std::mutex> lock(task.text_mutex);
+        end_message = task.end_message;
+    }
+
+    responses.notify(methodName(LspMethod::Progress), [&](JsonWriter &params) {
+        params.begin_object();
+        params.key("token");
+        write_token(params, task.token);
+        params.key("value");
+        params.begin_object();
+        params.key("kind");
+        switch (packet.kind)
+        {
+        case Send::Kind::Begin:
+            params.string("begin");
+            params.key("title");
+            params.string(task.title);
+            params.key("cancellable");
+            params.value(task.cancellable);
+            params.key("percentage");
+            params.value(0);
+            break;
+        case Send::Kind::Report:
+            params.string("report");
+            params.key("percentage");
+            params.value(packet.percentage);
+            if (packet.message.has_value())
+            {
+                params.key("message");
+                params.string(*packet.message);
+            }
+            break;
+        default:
+            params.string("end");
+            if (!end_message.empty())
+            {
+                params.key("message");
+                params.string(end_message);
+            }
+            break;
+        }
+        params.end_object();
+        params.end_object();
+    });
+}
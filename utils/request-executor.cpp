@@ -0,0 +1,281 @@
+#include "headers/request-executor.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Lets a worker find its own queue when it submits (or requeues) work
+    thread_local const RequestExecutor *current_executor = nullptr;
+    thread_local size_t current_worker = 0;
+
+    // Bucket b holds waits in [2^(b-1), 2^b) us, bucket 0 holds waits under 1 us
+    size_t wait_bucket(uint64_t us, size_t buckets)
+    {
+        size_t bucket = 0;
+        while (us != 0 && bucket + 1 < buckets)
+        {
+            us >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+}
+
+std::string_view laneName(PriorityLane lane)
+{
+    switch (lane)
+    {
+    case PriorityLane::Interactive:
+        return "interactive";
+    case PriorityLane::Normal:
+        return "normal";
+    case PriorityLane::Background:
+        return "background";
+    }
+    return "unknown";
+}
+
+RequestExecutor::RequestExecutor(size_t threads)
+{
+    if (threads == 0)
+    {
+        unsigned hardware = std::thread::hardware_concurrency();
+        threads = hardware > 2 ? hardware - 1 : 1;
+    }
+    thread_count = threads;
+
+    queues.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i)
+        queues.push_back(std::make_unique<WorkerQueue>());
+}
+
+RequestExecutor::~RequestExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void RequestExecutor::start()
+{
+    workers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i)
+        workers.emplace_back([this, i] { worker_loop(i); });
+}
+
+void RequestExecutor::push(Job job, bool front)
+{
+    // Work a worker creates stays with it, everything else is dealt out in turn
+    size_t target = current_executor == this ? current_worker
+                                             : next_queue.fetch_add(1, std::memory_order_relaxed) % thread_count;
+    size_t lane = static_cast<size_t>(job.lane);
+
+    // Counted before it can be taken, so take()'s decrement never gets there first. A worker that
+    // wakes in between finds nothing yet and just looks again, it doesn't go back to sleep
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++queued;
+    }
+    {
+        WorkerQueue &queue = *queues[target];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (front)
+            queue.lanes[lane].push_front(std::move(job));
+        else
+            queue.lanes[lane].push_back(std::move(job));
+        lanes[lane].depth.fetch_add(1, std::memory_order_release);
+    }
+    wake.notify_one();
+}
+
+void RequestExecutor::submit(PriorityLane lane, std::function<void()> task)
+{
+    submit_chunked(lane, [task = std::move(task)]() {
+        task();
+        return false;
+    });
+}
+
+void RequestExecutor::submit_chunked(PriorityLane lane, std::function<bool()> step)
+{
+    std::call_once(started, [this] { start(); });
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++outstanding;
+    }
+    push(Job{std::move(step), lane, Clock::now()}, false);
+}
+
+// Highest priority lane first, own queue before anyone else's
+// The lane depths let empty lanes be skipped without touching any queue's lock
+bool RequestExecutor::take(size_t self, Job &job)
+{
+    for (size_t lane = 0; lane < kLaneCount; ++lane)
+    {
+        if (lanes[lane].depth.load(std::memory_order_acquire) == 0)
+            continue;
+
+        for (size_t k = 0; k < thread_count; ++k)
+        {
+            WorkerQueue &queue = *queues[(self + k) % thread_count];
+            std::lock_guard<std::mutex> queue_lock(queue.mutex);
+            std::deque<Job> &jobs = queue.lanes[lane];
+            if (jobs.empty())
+                continue;
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            lanes[lane].depth.fetch_sub(1, std::memory_order_relaxed);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            --queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+void RequestExecutor::record_wait(const Job &job)
+{
+    auto waited = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - job.queued);
+    uint64_t us = waited.count() > 0 ? static_cast<uint64_t>(waited.count()) : 0;
+
+    LaneCounters &counters = lanes[static_cast<size_t>(job.lane)];
+    counters.started.fetch_add(1, std::memory_order_relaxed);
+    counters.wait_total_us.fetch_add(us, std::memory_order_relaxed);
+    counters.wait_buckets[wait_bucket(us, kWaitBuckets)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = counters.wait_max_us.load(std::memory_order_relaxed);
+    while (us > max && !counters.wait_max_us.compare_exchange_weak(max, us, std::memory_order_relaxed))
+    {
+    }
+}
+
+LaneStats RequestExecutor::lane_stats(PriorityLane lane) const
+{
+    const LaneCounters &counters = lanes[static_cast<size_t>(lane)];
+    LaneStats stats;
+    stats.depth = counters.depth.load(std::memory_order_relaxed);
+    stats.started = counters.started.load(std::memory_order_relaxed);
+    stats.max_wait_us = counters.wait_max_us.load(std::memory_order_relaxed);
+    if (stats.started == 0)
+        return stats;
+
+    stats.mean_wait_us = counters.wait_total_us.load(std::memory_order_relaxed) / stats.started;
+
+    // The counters are read one at a time while workers carry on, so this is close rather than exact
+    uint64_t total = 0;
+    uint64_t counts[kWaitBuckets];
+    for (size_t b = 0; b < kWaitBuckets; ++b)
+    {
+        counts[b] = counters.wait_buckets[b].load(std::memory_order_relaxed);
+        total += counts[b];
+    }
+
+    uint64_t target = total - total / 100;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kWaitBuckets; ++b)
+    {
+        seen += counts[b];
+        if (seen >= target)
+        {
+            stats.p99_wait_us = b == 0 ? 0 : (uint64_t(1) << b) - 1;
+            break;
+        }
+    }
+    return stats;
+}
+
+void RequestExecutor::parallel_for(size_t count, const std::function<void(size_t)> &task)
+{
+    // Nothing to share, skip the hand-off
+    if (count <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    // Helpers may only get to run after this has returned (the workers were busy), so they share
+    // this rather than the caller's stack, and never touch task once every index has been taken
+    struct Split
+    {
+        const std::function<void(size_t)> *task = nullptr;
+        size_t count = 0;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto split = std::make_shared<Split>();
+    split->task = &task;
+    split->count = count;
+
+    auto run = [](Split &s) {
+        for (size_t i = s.next.fetch_add(1, std::memory_order_relaxed); i < s.count;
+             i = s.next.fetch_add(1, std::memory_order_relaxed))
+        {
+            (*s.task)(i);
+            if (s.done.fetch_add(1, std::memory_order_acq_rel) + 1 == s.count)
+            {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(thread_count, count - 1);
+    for (size_t h = 0; h < helpers; ++h)
+        submit(PriorityLane::Interactive, [split, run] { run(*split); });
+
+    run(*split);
+
+    std::unique_lock<std::mutex> lock(split->mutex);
+    split->finished.wait(lock, [&] { return split->done.load(std::memory_order_acquire) == count; });
+}
+
+void RequestExecutor::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return outstanding == 0; });
+}
+
+void RequestExecutor::worker_loop(size_t self)
+{
+    current_executor = this;
+    current_worker = self;
+
+    while (true)
+    {
+        Job job;
+        if (!take(self, job))
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (queued == 0)
+            {
+                if (stopping)
+                    return; // nothing left to run
+                wake.wait(lock, [this] { return stopping || queued > 0; });
+            }
+            continue;
+        }
+
+        record_wait(job);
+        if (job.step())
+        {
+            // Chunk boundary, back through the lanes so anything more urgent goes first
+            job.queued = Clock::now();
+            push(std::move(job), true);
+            continue;
+        }
+
+        job.step = nullptr; // whatever it captured is released before the lock is taken
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--outstanding == 0)
+            idle.notify_all();
+    }
+}
@@ -0,0 +1,86 @@
+#include "headers/request-id.h"
+
+#include <charconv>
+#include <cstring>
+
+void RequestId::assign(long long number)
+{
+    kind = Kind::Number;
+    number_value = number;
+    heap_text.clear();
+}
+
+void RequestId::assign(std::string_view text)
+{
+    number_value = 0;
+    if (text.size() <= kInlineCapacity)
+    {
+        kind = Kind::Inline;
+        inline_size = static_cast<uint8_t>(text.size());
+        std::memcpy(inline_text, text.data(), text.size());
+        heap_text.clear();
+        return;
+    }
+
+    kind = Kind::Heap;
+    heap_text.assign(text.data(), text.size());
+}
+
+std::string_view RequestId::text() const
+{
+    switch (kind)
+    {
+    case Kind::Inline:
+        return std::string_view(inline_text, inline_size);
+    case Kind::Heap:
+        return heap_text;
+    default:
+        return std::string_view();
+    }
+}
+
+uint64_t RequestId::hash() const
+{
+    if (!is_string())
+    {
+        // splitmix64 finaliser, sequential counters spread over the whole range
+        uint64_t h = static_cast<uint64_t>(number_value) + 0x9E3779B97F4A7C15ULL;
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+        return h ^ (h >> 31);
+    }
+
+    // FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for (char c : text())
+    {
+        h ^= static_cast<unsigned char>(c);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+bool RequestId::operator==(const RequestId &other) const
+{
+    // 1 and "1" are different ids
+    if (is_string() != other.is_string())
+        return false;
+    if (!is_string())
+        return number_value == other.number_value;
+    return text() == other.text();
+}
+
+void appendLogArg(std::string &out, const RequestId &id)
+{
+    if (id.is_string())
+    {
+        out.push_back('"');
+        out += id.text();
+        out.push_back('"');
+        return;
+    }
+
+    char digits[24];
+    std::to_chars_result r = std::to_chars(digits, digits + sizeof(digits), id.number());
+    out.append(digits, r.ptr);
+}
@@ -0,0 +1,112 @@
+#include "headers/response-sequencer.h"
+#include "headers/trace-log.h"
+
+namespace
+{
+    constexpr size_t kInitialSlots = 64;
+}
+
+ResponseSequencer::ResponseSequencer(Transport &out) : out(out), slots(kInitialSlots)
+{
+}
+
+// Only happens with more requests in flight than slots, the held bodies are moved, not copied
+void ResponseSequencer::grow()
+{
+    std::vector<Slot> grown(slots.size() * 2);
+    for (uint64_t ticket = first; ticket < next; ++ticket)
+        grown[ticket % grown.size()] = std::move(slot(ticket));
+    slots.swap(grown);
+}
+
+uint64_t ResponseSequencer::reserve(bool ordered)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (next - first == slots.size())
+        grow();
+
+    Slot &s = slot(next);
+    s.ordered = ordered;
+    s.done = false;
+    s.released = false;
+    return next++;
+}
+
+void ResponseSequencer::complete(uint64_t ticket, std::string &body)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ticket < first || ticket >= next)
+        return;
+
+    Slot &s = slot(ticket);
+    s.body.swap(body);
+    body.clear();
+    s.done = true;
+    release_ready();
+}
+
+// Walks the window in ticket order, queuing every response that nothing earlier is holding up
+// The walk stops at the first unreleased ordered ticket, as everything after it has to wait anyway
+void ResponseSequencer::release_ready()
+{
+    bool earlier_held = false;
+    for (uint64_t ticket = first; ticket < next; ++ticket)
+    {
+        Slot &s = slot(ticket);
+        if (s.released)
+            continue;
+
+        if (s.done && (!s.ordered || !earlier_held))
+        {
+            if (!s.body.empty())
+                writer.enqueue_response(s.body);
+            s.released = true;
+            continue;
+        }
+
+        if (s.ordered)
+            break;
+        earlier_held = true;
+    }
+
+    // Retire the released prefix, the slots keep their buffers for the next tickets
+    while (first < next && slot(first).released)
+        ++first;
+    if (first == next)
+        all_released.notify_all();
+}
+
+void ResponseSequencer::wait_released()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    all_released.wait(lock, [this] { return first == next; });
+}
+
+bool ResponseSequencer::flush()
+{
+    std::lock_guard<std::mutex> write_lock(write_mutex);
+    {
+        // Taken out from under the lock, so a write the client is slow to read doesn't hold it
+        std::lock_guard<std::mutex> lock(mutex);
+        writer.hand_over(sending);
+    }
+
+    size_t bytes = sending.pending_bytes();
+    if (!sending.flush(out))
+        return false;
+    if (bytes > 0)
+        traceEvent(TracePhase::Respond, LspMethod::Unknown, nullptr, bytes);
+    return true;
+}
+
+void ResponseSequencer::begin_batch()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    writer.begin_batch();
+}
+
+bool ResponseSequencer::end_batch()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return writer.end_batch();
+}
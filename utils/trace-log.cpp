@@ -0,0 +1,141 @@
+#include "headers/trace-log.h"
+#include "headers/mapped-file.h"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+// Records are appended by reserving space with one atomic add and copying into the mapping,
+// so tracing never takes a lock or makes a syscall on the request path
+// The segment is a fixed size, records that don't fit are counted and dropped
+// closeTrace may race with workers still tracing, so it waits for every writer inside the mapping to leave first
+
+namespace
+{
+    MappedFile segment;
+    std::atomic<size_t> write_offset{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint32_t> writers{0}; // traceEvent calls between their check of active and their last write
+    bool capture = false;
+    std::chrono::steady_clock::time_point start;
+
+    constexpr size_t align8(size_t n)
+    {
+        return (n + 7) & ~static_cast<size_t>(7);
+    }
+}
+
+std::atomic<bool> trace_detail::active{false};
+
+bool openTrace(const std::string &path, bool capture_bodies, size_t capacity)
+{
+    if (traceEnabled() || capacity < sizeof(TraceFileHeader) + sizeof(TraceRecord))
+        return false;
+    if (!segment.create(path, capacity))
+        return false;
+
+    TraceFileHeader header{};
+    std::memcpy(header.magic, kTraceMagic, sizeof(header.magic));
+    header.version = kTraceVersion;
+    header.header_size = sizeof(TraceFileHeader);
+    header.start_unix_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    std::memcpy(segment.data(), &header, sizeof(header));
+
+    write_offset.store(sizeof(TraceFileHeader), std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+    capture = capture_bodies;
+    start = std::chrono::steady_clock::now();
+    trace_detail::active.store(true, std::memory_order_release);
+    return true;
+}
+
+void closeTrace()
+{
+    // Sequentially consistent, paired with traceEvent: either a writer sees active turned off,
+    // or it is counted in writers here and the segment stays mapped until it is done
+    if (!trace_detail::active.exchange(false, std::memory_order_seq_cst))
+        return;
+    while (writers.load(std::memory_order_seq_cst) != 0)
+        std::this_thread::yield();
+
+    size_t used = write_offset.load(std::memory_order_relaxed);
+    if (used > segment.size())
+        used = segment.size();
+
+    TraceFileHeader header;
+    std::memcpy(&header, segment.data(), sizeof(header));
+    header.used_bytes = used;
+    header.dropped_records = dropped.load(std::memory_order_relaxed);
+    std::memcpy(segment.data(), &header, sizeof(header));
+
+    segment.close(used);
+}
+
+void traceEvent(TracePhase phase, LspMethod method, const RequestId *id, size_t body_size, std::string_view raw)
+{
+    if (!traceEnabled())
+        return;
+
+    TraceRecord record{};
+    uint64_t elapsed = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    record.timestamp_ns = elapsed > 0 ? elapsed : 1; // 0 is the end marker
+    record.body_size = static_cast<uint32_t>(body_size > UINT32_MAX ? UINT32_MAX : body_size);
+    record.raw_size = capture && raw.size() <= UINT32_MAX ? static_cast<uint32_t>(raw.size()) : 0;
+    record.phase = phase;
+    record.method = method;
+
+    if (id != nullptr && id->is_string())
+    {
+        std::string_view text = id->text();
+        record.id_kind = TraceIdKind::String;
+        record.id_size = static_cast<uint8_t>(text.size() < kTraceIdText ? text.size() : kTraceIdText);
+        std::memcpy(record.id_text, text.data(), record.id_size);
+    }
+    else if (id != nullptr)
+    {
+        record.id_kind = TraceIdKind::Number;
+        record.id_number = id->number();
+    }
+
+    // Registered before looking at active again, so closeTrace can't unmap the segment underneath us
+    writers.fetch_add(1, std::memory_order_seq_cst);
+    if (!trace_detail::active.load(std::memory_order_seq_cst))
+    {
+        writers.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+
+    // Claim space, then fill it in, concurrent writers never touch the same bytes
+    size_t total = sizeof(TraceRecord) + align8(record.raw_size);
+    size_t offset = write_offset.fetch_add(total, std::memory_order_relaxed);
+    if (offset + total > segment.size())
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        char *dst = segment.data() + offset;
+        std::memcpy(dst, &record, sizeof(record));
+        if (record.raw_size > 0)
+            std::memcpy(dst + sizeof(record), raw.data(), record.raw_size);
+    }
+    writers.fetch_sub(1, std::memory_order_release);
+}
+
+const char *tracePhaseName(TracePhase phase)
+{
+    switch (phase)
+    {
+    case TracePhase::Receive:
+        return "recv";
+    case TracePhase::Decode:
+        return "decode";
+    case TracePhase::Dispatch:
+        return "dispatch";
+    case TracePhase::Respond:
+        return "respond";
+    }
+    return "?";
+}
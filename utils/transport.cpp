@@ -0,0 +1,186 @@
+#include "headers/transport.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <poll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+// Transports move raw bytes in/out of the server
+// Framing (Content-Length etc.) is handled by byte-stream-to-json.cpp, and encoding by JSON-encode.cpp
+
+bool Transport::write_segments(const std::string_view *segments, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!write_all(segments[i].data(), segments[i].size()))
+            return false;
+    }
+    return true;
+}
+
+StreamTransport::StreamTransport(std::istream &in, std::ostream &out)
+    : in(in), out(out)
+{
+}
+
+size_t StreamTransport::read_some(char *dst, size_t min_bytes, size_t capacity)
+{
+    if (!in.good())
+        return 0;
+
+    // Block for what is needed, plus whatever the stream already has buffered
+    size_t count = min_bytes;
+    std::streamsize avail = in.rdbuf()->in_avail();
+    if (avail > 0 && static_cast<size_t>(avail) > count)
+        count = static_cast<size_t>(avail) < capacity ? static_cast<size_t>(avail) : capacity;
+
+    in.read(dst, static_cast<std::streamsize>(count));
+    return static_cast<size_t>(in.gcount());
+}
+
+bool StreamTransport::write_all(const char *data, size_t size)
+{
+    out.write(data, static_cast<std::streamsize>(size));
+    out.flush();
+    return out.good();
+}
+
+#ifndef _WIN32
+namespace
+{
+    // Segments handed to a single writev call (IOV_MAX is at least 1024 on Linux, 16 by POSIX minimum)
+    constexpr int kMaxIovecs = 64;
+
+    // Waits until fd is ready for `events` (or hung up, which the next read/write will report)
+    bool wait_for(int fd, short events)
+    {
+        pollfd pfd{};
+        pfd.fd = fd;
+        pfd.events = events;
+
+        while (true)
+        {
+            int ready = poll(&pfd, 1, -1);
+            if (ready > 0)
+                return (pfd.revents & POLLNVAL) == 0;
+            if (ready < 0 && errno != EINTR)
+                return false;
+        }
+    }
+}
+
+FdTransport::FdTransport(int in_fd, int out_fd)
+    : in_fd(in_fd), out_fd(out_fd)
+{
+}
+
+size_t FdTransport::read_some(char *dst, size_t min_bytes, size_t capacity)
+{
+    size_t total = 0;
+    while (total < min_bytes)
+    {
+        // Always ask for the whole free space, so bursts of messages come in with one syscall
+        ssize_t n = ::read(in_fd, dst + total, capacity - total);
+        if (n > 0)
+        {
+            total += static_cast<size_t>(n);
+            continue;
+        }
+
+        // EOF
+        if (n == 0)
+            break;
+
+        if (errno == EINTR)
+            continue;
+
+        if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_for(in_fd, POLLIN))
+            continue;
+
+        break;
+    }
+    return total;
+}
+
+bool FdTransport::write_all(const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t n = ::write(out_fd, data, size);
+        if (n > 0)
+        {
+            data += n;
+            size -= static_cast<size_t>(n);
+            continue;
+        }
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && wait_for(out_fd, POLLOUT))
+            continue;
+
+        return false;
+    }
+    return true;
+}
+
+bool FdTransport::write_segments(const std::string_view *segments, size_t count)
+{
+    iovec vecs[kMaxIovecs];
+
+    // Progress through the segments; `offset` bytes of segments[index] have already been written
+    size_t index = 0;
+    size_t offset = 0;
+
+    while (true)
+    {
+        while (index < count && offset == segments[index].size())
+        {
+            ++index;
+            offset = 0;
+        }
+        if (index >= count)
+            return true;
+
+        // Gather as many of the remaining segments as fit into one call
+        int used = 0;
+        for (size_t k = index; k < count && used < kMaxIovecs; ++k)
+        {
+            size_t skip = k == index ? offset : 0;
+            if (segments[k].size() == skip)
+                continue;
+            vecs[used].iov_base = const_cast<char *>(segments[k].data() + skip);
+            vecs[used].iov_len = segments[k].size() - skip;
+            ++used;
+        }
+
+        ssize_t n = ::writev(out_fd, vecs, used);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_for(out_fd, POLLOUT))
+                continue;
+            return false;
+        }
+
+        // Partial writes are normal on pipes, walk forward by what was accepted
+        size_t written = static_cast<size_t>(n);
+        while (written > 0)
+        {
+            size_t left = segments[index].size() - offset;
+            if (written < left)
+            {
+                offset += written;
+                break;
+            }
+            written -= left;
+            ++index;
+            offset = 0;
+        }
+    }
+}
+#endif